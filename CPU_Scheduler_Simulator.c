@@ -1,37 +1,269 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
 #include <unistd.h>
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "scheduler_internal.h"
 
+#define CHECKPOINT_EVERY 1000
+
+#define HIST_SUB_BITS 7
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((32 - HIST_SUB_BITS) * HIST_SUB_COUNT)
+
+/* Log-linear histogram of non-negative times; each bucket is within 1% of its values. */
+typedef struct {
+    long long counts[HIST_BUCKETS];
+    long long total;
+    double sum;
+    int max;
+} Histogram;
+
+#define STREAM_BUFFER_SIZE (1 << 16)
+
+typedef struct {
+    int fd;
+    char *data;
+    size_t len;
+    size_t pos;         /* start of the next unread line */
+    size_t capacity;
+    int eof;
+    int line;
+    long long records;
+    int started;
+    int binary;         /* fixed-width records after a BinaryHeader */
+} StreamReader;
+
+#define BINARY_TRACE_MAGIC "SCHDPROC"
+#define BINARY_GANTT_MAGIC "SCHDGANT"
+#define BINARY_CHECKPOINT_MAGIC "SCHDCKPT"
+#define BINARY_MAGIC_SIZE 8
+#define BINARY_VERSION 1
+#define BINARY_BYTE_ORDER 0x01020304u
+
+/*
+ * Header of the binary trace and Gantt formats, followed by count records of
+ * record_size bytes in the writer's byte order. Trace records are Process
+ * rows with the run-time fields at their initial values, so a mapped trace
+ * is simulated in place. Gantt records are GanttRecord. Checkpoint files
+ * count Checkpoint records but hold more sections; see save_checkpoints().
+ */
+typedef struct {
+    char magic[BINARY_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t byte_order;    /* BINARY_BYTE_ORDER as written */
+    uint32_t record_size;
+    uint32_t reserved;
+    uint64_t count;
+} BinaryHeader;
+
+typedef struct {
+    int32_t cpu;
+    int32_t process_id;
+    int32_t start_time;
+    int32_t end_time;
+} GanttRecord;
+
+/* Whole input file, mapped when possible and read into memory otherwise. */
+typedef struct {
+    char *data;
+    size_t size;
+    int mapped;
+} InputFile;
+
+/* Follows the BinaryHeader of a checkpoint file; a run must use the same policy to resume from it. */
+typedef struct {
+    int32_t algo;
+    int32_t quantum;
+    int32_t aging;
+    int32_t context_switch;
+    int32_t dispatch;
+    int32_t cache_warmup;
+    int32_t every;
+    int32_t process_count;
+    int64_t gantt_count;
+    int64_t record_count;
+} CheckpointSettings;
+
+/* A loaded checkpoint file; the arrays point into file. */
 typedef struct {
-    int id;
-    int arrival;
-    int burst;
-    int priority;
-    int remaining_bt;
-    int waiting;
-    int tat;
-    int ct; 
-} Process;
+    InputFile file;
+    CheckpointSettings settings;
+    const Checkpoint *points;
+    int count;
+    const CheckpointProcess *records;
+    const Process *base;
+    const GanttEntry *gantt;
+} CheckpointFile;
 
+#define RT_HORIZON_LIMIT 10000000   /* longest default horizon; past it --horizon is required */
+
+typedef enum {
+    CHART_NONE,
+    CHART_STATIC,
+    CHART_ANIMATED
+} ChartMode;
+
+typedef struct {
+    ChartMode mode;
+    int delay_ms;       /* per time unit when animating */
+} ChartOptions;
+
+#define TEXT_BUFFER_SIZE (1 << 20)
+#define CHART_BAR_WIDTH 60
+
+typedef struct {
+    FILE *out;
+    char *data;
+    size_t len;
+} TextBuffer;
+
+/* Streams per-process results as CSV rows or a JSON document, keeping only running totals. */
+typedef struct {
+    TextBuffer *tb;
+    int json;
+    long long rows;
+    double total_waiting;
+    double total_tat;
+    double total_response;
+} ResultWriter;
+
+/* A streaming replay: the engine's arrival source and what it has seen so far. */
 typedef struct {
-    int process_id;
-    int start_time;
-    int end_time;
-} GanttEntry;
+    SchedStream source;         /* processes in flight, switches and overhead */
+    StreamReader *in;
+    ResultWriter *results;      /* NULL = no result rows */
+    long long report_every;     /* progress line every this many completions, 0 = none */
+    Histogram waiting;
+    Histogram tat;
+    Histogram response;
+    long long completed;
+    long long busy;
+    int first_arrival;
+    int now;
+} StreamStats;
+
+#define WORKLOAD_MEAN_BURST 10.0
+#define WORKLOAD_LOAD 0.9
+#define WORKLOAD_MAX_BURST 100000
+#define WORKLOAD_TIME_LIMIT 2000000000
 
+typedef enum {
+    WL_UNIFORM,         /* arrivals uniform over the horizon */
+    WL_POISSON,         /* exponential inter-arrival times */
+    WL_PARETO,          /* Poisson arrivals, Pareto (heavy-tailed) bursts */
+    WL_BURSTY,          /* on-off arrival bursts */
+    WL_ZERO,            /* everything arrives at time 0 */
+    WL_COUNT
+} WorkloadKind;
+
+/* Distribution of a synthetic workload; the benchmark suite uses the WORKLOAD_ defaults. */
+typedef struct {
+    WorkloadKind kind;
+    double mean_burst;
+    double load;        /* offered CPU utilisation; arrivals are spaced to match */
+} WorkloadSpec;
 
+TextBuffer *tb_open(FILE *out);
+void tb_flush(TextBuffer *tb);
+void tb_close(TextBuffer *tb);
+void tb_write(TextBuffer *tb, const char *text, size_t len);
+void tb_str(TextBuffer *tb, const char *text);
+void tb_int(TextBuffer *tb, long long value);
+void tb_fill(TextBuffer *tb, char c, int count);
+void tb_segment(TextBuffer *tb, int process_id);
 int validate_inputs(Process processes[], int n, int quantum);
+int validate_horizon(Process processes[], int n, Algorithm algo, int quantum);
 void input_processes(Process processes[], int n, int algo_choice);
 void reset_processes(Process dest[], Process src[], int n);
 void print_results(Process processes[], int n, float awt, float atat);
-void display_gantt_chart(GanttEntry gantt[], int count);
-void fcfs(Process processes[], int n, float results[], GanttEntry gantt[], int *gantt_index);
-void sjf_non_preemptive(Process processes[], int n, float results[], GanttEntry gantt[], int *gantt_index);
-void sjf_preemptive(Process processes[], int n, float results[], GanttEntry gantt[], int *gantt_index);
-void rr(Process processes[], int n, float results[], GanttEntry gantt[], int *gantt_index, int quantum);
-void priority_non_preemptive(Process processes[], int n, float results[], GanttEntry gantt[], int *gantt_index);
-void priority_preemptive(Process processes[], int n, float results[], GanttEntry gantt[], int *gantt_index);
+void display_gantt_chart(GanttEntry gantt[], int count, const ChartOptions *chart);
+void print_timeline_queries(const GanttLog gantts[], int cpus, int at, int busy_from, int busy_to);
+int algorithm_from_name(const char *name);
+int overhead_enabled(void);
+SchedConfig algorithm_config(Algorithm algo, int quantum);
+void schedule(Algorithm algo, Process processes[], int n, float results[], GanttLog *gantt, int quantum);
+void run_algorithm(Algorithm algo, Process processes[], int n, float results[], GanttLog *gantt, int quantum, const ChartOptions *chart);
+SchedPolicy algorithm_policy(Algorithm algo, int quantum);
+void schedule_smp(Algorithm algo, Process processes[], int n, float results[], GanttLog gantts[],
+                  int quantum, int cpus, SmpStats *stats);
+void run_algorithm_smp(Algorithm algo, Process processes[], int n, float results[], GanttLog gantts[],
+                       int quantum, int cpus, const ChartOptions *chart);
+int parse_chart_mode(const char *name);
+int parse_trace(const char *data, size_t size, Process **table, int *capacity, BurstPlan *plan);
+int load_trace(const char *path, Process **table, int *capacity, InputFile *file, BurstPlan *plan);
+void release_trace(Process *table, InputFile *file, BurstPlan *plan);
+void burst_plan_free(BurstPlan *plan);
+void write_trace_csv(const Process p[], int n, const BurstPlan *plan, FILE *out);
+void write_trace_binary(const Process p[], int n, FILE *out);
+void write_gantt_csv(const GanttLog gantts[], int cpus, FILE *out);
+void write_gantt_binary(const GanttLog gantts[], int cpus, FILE *out);
+int save_trace(const char *path, const Process p[], int n, const BurstPlan *plan);
+int save_gantt(const char *path, const GanttLog gantts[], int cpus);
+void write_gantt_chrome(const GanttLog gantts[], int cpus, FILE *out);
+void results_begin(ResultWriter *w, FILE *out, int json);
+void results_row(ResultWriter *w, const Process *p);
+void results_end(ResultWriter *w);
+int save_results(const char *path, const Process p[], int n);
+CheckpointSettings checkpoint_settings(Algorithm algo, const SchedPolicy *policy, int every);
+int save_checkpoints(const char *path, const CheckpointLog *log, CheckpointSettings settings,
+                     const Process p[], int n, const GanttLog *gantt);
+int load_checkpoints(const char *path, CheckpointFile *cf);
+void release_checkpoints(CheckpointFile *cf);
+int first_change(const Process old[], int old_n, const Process p[], int n);
+const Checkpoint *checkpoint_before(const CheckpointFile *cf, int time);
+int convert_file(const char *in_path, const char *out_path);
+void hist_reset(Histogram *h);
+void hist_record(Histogram *h, int value);
+double hist_mean(const Histogram *h);
+int hist_percentile(const Histogram *h, double percentile);
+void print_percentiles(const char *label, const Histogram *h);
+void print_latency_table(const Histogram *waiting, const Histogram *tat, const Histogram *response);
+void print_throughput(long long completed, long long busy, int first_arrival, int last_completion,
+                      int cpus, long long switches, long long overhead);
+void print_metrics(Process processes[], int n, const GanttLog gantts[], int cpus);
+void print_io_summary(const BurstPlan *plan, const Process p[], int n);
+StreamReader *stream_open(const char *path);
+void stream_close(StreamReader *in);
+int stream_next(StreamReader *in, Process *p);
+int run_stream(const char *path, Algorithm algo, int quantum, long long report_every, const char *results_out);
+int rt_policy_from_name(const char *name);
+int load_tasks(const char *path, RtTask **tasks);
+void print_rt_results(const RtTask tasks[], int n, const RtStats *st);
+void print_rt_bounds(const RtTask tasks[], int n, RtPolicy policy);
+int run_realtime(const char *path, RtPolicy policy, int horizon, unsigned long long seed, const ChartOptions *chart,
+                 const char *gantt_out);
+void print_usage(const char *prog);
+int run_batch(int argc, char *argv[]);
+int run_interactive(const ChartOptions *chart);
+int parse_quanta(const char *spec, int **quanta);
+int parse_mlfq_quanta(const char *spec, MlfqConfig *config);
+int default_thread_count(void);
+int workload_from_name(const char *name);
+double rng_uniform(Rng *rng);
+void generate_workload(Process p[], int n, const WorkloadSpec *spec, unsigned long long seed);
+long peak_rss_kb(void);
+void run_benchmarks(int max_n, unsigned long long seed, int quantum, int reps,
+                    double budget_s, int json, FILE *out);
+void write_workload(const WorkloadSpec *spec, int n, unsigned long long seed, FILE *out);
+int parse_algorithm_list(const char *spec, unsigned *mask);
+void compare_algorithms(Process processes[], int n, unsigned algorithms, const int quanta[], int quantum_count,
+                        int threads, int cpus);
+int run_monte_carlo(const WorkloadSpec *spec, int n, int replicates, unsigned long long seed, unsigned algorithms,
+                    const int quanta[], int quantum_count, int threads, int cpus);
+int tune_quantum(Process processes[], int n, const int quanta[], int count,
+                 const double weights[3], int prune, int threads);
+int parse_objective(const char *spec, double weights[3]);
 
 int validate_inputs(Process processes[], int n, int quantum) {
     for (int i = 0; i < n; i++) {
@@ -40,513 +272,3187 @@ int validate_inputs(Process processes[], int n, int quantum) {
             return 0;
         }
     }
-    if (quantum <= 0) {
-        printf("Invalid input: Time quantum must be positive for Round Robin.\n");
+    if (quantum <= 0) {
+        printf("Invalid input: Time quantum must be positive for Round Robin.\n");
+        return 0;
+    }
+    return 1;
+}
+
+/* Rejects a table on which algo could run the clock past INT_MAX. */
+int validate_horizon(Process processes[], int n, Algorithm algo, int quantum) {
+    SchedPolicy policy = algorithm_policy(algo, quantum);
+    if (algo >= ALGO_MLFQ)
+        policy.overhead = NULL;
+    if (!sched_time_fits(&policy, processes, n)) {
+        printf("Invalid input: The last arrival plus all CPU, I/O and switch time must not pass %d.\n", INT_MAX);
+        return 0;
+    }
+    return 1;
+}
+
+void input_processes(Process processes[], int n, int algo_choice) {
+    for (int i = 0; i < n; i++) {
+        processes[i].id = i + 1;
+        printf("Process %d\n", i + 1);
+        printf("Arrival Time: "); scanf("%d", &processes[i].arrival);
+        printf("Burst Time: "); scanf("%d", &processes[i].burst);
+        
+        if (algo_choice == 4) {
+            printf("Priority (lower number = higher priority): "); scanf("%d", &processes[i].priority);
+        } else {
+            processes[i].priority = 0; 
+        }
+        processes[i].remaining_bt = processes[i].burst;
+        processes[i].cpu = -1;
+    }
+}
+
+void reset_processes(Process dest[], Process src[], int n) {
+    for (int i = 0; i < n; i++) {
+        dest[i] = src[i];
+        dest[i].remaining_bt = dest[i].burst;
+        dest[i].waiting = 0;
+        dest[i].tat = 0;
+        dest[i].ct = 0; 
+        dest[i].rt = -1;
+    }
+}
+
+void print_results(Process processes[], int n, float awt, float atat) {
+    TextBuffer *tb = tb_open(stdout);
+    char line[64];
+    double total_rt = 0;
+    tb_str(tb, "\nID\tArrival\tBurst\tPriority\tCT\tWaiting\tTAT\tRT\n");
+    for (int i = 0; i < n; i++) {
+        tb_int(tb, processes[i].id);
+        tb_str(tb, "\t");
+        tb_int(tb, processes[i].arrival);
+        tb_str(tb, "\t");
+        tb_int(tb, processes[i].burst);
+        tb_str(tb, "\t");
+        tb_int(tb, processes[i].priority);
+        tb_str(tb, "\t\t");
+        tb_int(tb, processes[i].ct);
+        tb_str(tb, "\t");
+        tb_int(tb, processes[i].waiting);
+        tb_str(tb, "\t");
+        tb_int(tb, processes[i].tat);
+        tb_str(tb, "\t");
+        tb_int(tb, processes[i].rt);
+        tb_str(tb, "\n");
+        total_rt += processes[i].rt;
+    }
+    snprintf(line, sizeof(line), "\nAverage Waiting Time: %.2f\n", awt);
+    tb_str(tb, line);
+    snprintf(line, sizeof(line), "Average Turnaround Time: %.2f\n", atat);
+    tb_str(tb, line);
+    snprintf(line, sizeof(line), "Average Response Time: %.2f\n", total_rt / n);
+    tb_str(tb, line);
+    tb_close(tb);
+}
+
+/*
+ * CHART_STATIC writes the whole chart through one buffer and scales the bars
+ * so the longest segment is CHART_BAR_WIDTH wide. CHART_ANIMATED draws one
+ * '#' per time unit with chart->delay_ms between them.
+ */
+void display_gantt_chart(GanttEntry gantt[], int count, const ChartOptions *chart) {
+    if (chart->mode == CHART_NONE)
+        return;
+
+    TextBuffer *tb = tb_open(stdout);
+    tb_str(tb, "\nGantt Chart:\n");
+    int longest = 0;
+    for (int i = 0; i < count; i++) {
+        tb_str(tb, "| ");
+        tb_segment(tb, gantt[i].process_id);
+        tb_str(tb, " (");
+        tb_int(tb, gantt[i].start_time);
+        tb_str(tb, "-");
+        tb_int(tb, gantt[i].end_time);
+        tb_str(tb, ") ");
+        if (gantt[i].end_time - gantt[i].start_time > longest)
+            longest = gantt[i].end_time - gantt[i].start_time;
+    }
+    tb_str(tb, "|\n");
+
+    if (chart->mode == CHART_ANIMATED) {
+        tb_close(tb);
+        struct timespec delay = { chart->delay_ms / 1000, (chart->delay_ms % 1000) * 1000000L };
+        for (int i = 0; i < count; i++) {
+            if (gantt[i].process_id == GANTT_OVERHEAD_ID)
+                printf("\nProcessing CS [");
+            else
+                printf("\nProcessing P%d [", gantt[i].process_id);
+            int duration = gantt[i].end_time - gantt[i].start_time;
+            for (int j = 0; j < duration; j++) {
+                printf("#");
+                fflush(stdout);
+                if (chart->delay_ms > 0)
+                    nanosleep(&delay, NULL);
+            }
+            printf("] %d-%d ", gantt[i].start_time, gantt[i].end_time);
+        }
+        printf("\n");
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int duration = gantt[i].end_time - gantt[i].start_time;
+        int width = duration;
+        if (longest > CHART_BAR_WIDTH) {
+            width = (int)((long long)duration * CHART_BAR_WIDTH / longest);
+            if (width == 0)
+                width = 1;
+        }
+        tb_str(tb, "\nProcessing ");
+        tb_segment(tb, gantt[i].process_id);
+        tb_str(tb, " [");
+        tb_fill(tb, '#', width);
+        tb_str(tb, "] ");
+        tb_int(tb, gantt[i].start_time);
+        tb_str(tb, "-");
+        tb_int(tb, gantt[i].end_time);
+        tb_str(tb, " ");
+    }
+    tb_str(tb, "\n");
+    tb_close(tb);
+}
+
+static void *checked_alloc(size_t size) {
+    void *ptr = malloc(size);
+    if (ptr == NULL && size > 0) {
+        printf("Out of memory while preparing the simulation.\n");
+        exit(1);
+    }
+    return ptr;
+}
+
+static Process *checked_reserve(Process *table, int *capacity, int n) {
+    table = reserve_processes(table, capacity, n);
+    if (table == NULL) {
+        printf("Out of memory while allocating %d processes.\n", n);
+        exit(1);
+    }
+    return table;
+}
+
+/* The library reports failures and leaves the message to us. */
+static void checked_run(SchedStatus status) {
+    if (status != SCHED_OK) {
+        printf("%s\n", sched_strerror(status));
+        exit(1);
+    }
+}
+
+TextBuffer *tb_open(FILE *out) {
+    TextBuffer *tb = checked_alloc(sizeof(TextBuffer));
+    tb->out = out;
+    tb->len = 0;
+    tb->data = checked_alloc(TEXT_BUFFER_SIZE);
+    return tb;
+}
+
+void tb_flush(TextBuffer *tb) {
+    if (tb->len > 0)
+        fwrite(tb->data, 1, tb->len, tb->out);
+    tb->len = 0;
+}
+
+void tb_close(TextBuffer *tb) {
+    tb_flush(tb);
+    free(tb->data);
+    free(tb);
+}
+
+void tb_write(TextBuffer *tb, const char *text, size_t len) {
+    if (tb->len + len > TEXT_BUFFER_SIZE) {
+        tb_flush(tb);
+        if (len > TEXT_BUFFER_SIZE) {
+            fwrite(text, 1, len, tb->out);
+            return;
+        }
+    }
+    memcpy(tb->data + tb->len, text, len);
+    tb->len += len;
+}
+
+void tb_str(TextBuffer *tb, const char *text) {
+    tb_write(tb, text, strlen(text));
+}
+
+void tb_int(TextBuffer *tb, long long value) {
+    char digits[24];
+    int pos = sizeof(digits);
+    unsigned long long v = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    do {
+        digits[--pos] = '0' + v % 10;
+        v /= 10;
+    } while (v > 0);
+    if (value < 0)
+        digits[--pos] = '-';
+    tb_write(tb, digits + pos, sizeof(digits) - pos);
+}
+
+void tb_fill(TextBuffer *tb, char c, int count) {
+    while (count > 0) {
+        if (tb->len == TEXT_BUFFER_SIZE)
+            tb_flush(tb);
+        int chunk = TEXT_BUFFER_SIZE - tb->len;
+        if (chunk > count)
+            chunk = count;
+        memset(tb->data + tb->len, c, chunk);
+        tb->len += chunk;
+        count -= chunk;
+    }
+}
+
+/* Chart label for a Gantt segment: P<id>, or CS for switch overhead. */
+void tb_segment(TextBuffer *tb, int process_id) {
+    if (process_id == GANTT_OVERHEAD_ID) {
+        tb_str(tb, "CS");
+        return;
+    }
+    tb_str(tb, "P");
+    tb_int(tb, process_id);
+}
+
+const char *algorithm_names[ALGO_COUNT] = {
+    "fcfs", "sjf", "srtf", "rr", "priority", "priority-preemptive", "mlfq", "cfs"
+};
+
+MlfqConfig mlfq_config = { 3, { 2, 4, 8 }, 100 };
+int priority_aging = 0;     /* time units of waiting per priority level gained, 0 = off */
+OverheadModel overhead_model = { 0, 0, 0 };
+BurstPlan trace_bursts;     /* burst sequences of the loaded trace, empty when it does no I/O */
+CheckpointLog *checkpoint_log;      /* single runs checkpoint into this when set */
+const ResumePoint *resume_point;    /* single runs start here instead of at the first arrival when set */
+
+int overhead_enabled(void) {
+    return overhead_model.context_switch > 0 || overhead_model.dispatch > 0 || overhead_model.cache_warmup > 0;
+}
+
+const char *algorithm_titles[ALGO_COUNT] = {
+    "FCFS Scheduling",
+    "SJF (Non-Preemptive) Scheduling",
+    "SJF Preemptive (SRTF) Scheduling",
+    "Round Robin Scheduling",
+    "Priority (Non-Preemptive) Scheduling",
+    "Priority Preemptive Scheduling",
+    "Multilevel Feedback Queue Scheduling",
+    "Completely Fair Scheduling"
+};
+
+int algorithm_from_name(const char *name) {
+    for (int a = 0; a < ALGO_COUNT; a++) {
+        if (strcmp(name, algorithm_names[a]) == 0)
+            return a;
+    }
+    return -1;
+}
+
+int parse_chart_mode(const char *name) {
+    if (strcmp(name, "none") == 0)
+        return CHART_NONE;
+    if (strcmp(name, "static") == 0)
+        return CHART_STATIC;
+    if (strcmp(name, "animate") == 0)
+        return CHART_ANIMATED;
+    return -1;
+}
+
+/* The run settings of the command line or menu, which every run of algo shares. */
+SchedConfig algorithm_config(Algorithm algo, int quantum) {
+    SchedConfig config = { algo, quantum, priority_aging, &mlfq_config, overhead_enabled() ? &overhead_model : NULL,
+                           trace_bursts.first != NULL ? &trace_bursts : NULL, checkpoint_log, resume_point };
+    return config;
+}
+
+void schedule(Algorithm algo, Process processes[], int n, float results[], GanttLog *gantt, int quantum) {
+    SchedConfig config = algorithm_config(algo, quantum);
+    checked_run(sched_run(&config, processes, n, results, gantt));
+}
+
+void run_algorithm(Algorithm algo, Process processes[], int n, float results[], GanttLog *gantt, int quantum, const ChartOptions *chart) {
+    printf("\n--- %s ---\n", algorithm_titles[algo]);
+    if (algo == ALGO_RR)
+        printf("\nRound Robin Scheduling with Time Quantum: %d\n", quantum);
+    if (algo == ALGO_MLFQ) {
+        printf("\nLevels: %d, Quanta:", mlfq_config.levels);
+        for (int l = 0; l < mlfq_config.levels; l++)
+            printf(" %d", mlfq_config.quanta[l]);
+        printf(", Boost Period: %d\n", mlfq_config.boost_period);
+    }
+    if ((algo == ALGO_PRIORITY || algo == ALGO_PRIORITY_PREEMPTIVE) && priority_aging > 0)
+        printf("\nAging: one priority level per %d time units waited\n", priority_aging);
+    if (overhead_enabled() && algo < ALGO_MLFQ)
+        printf("\nOverhead: switch %d, dispatch %d, cache warm-up %d\n", overhead_model.context_switch,
+               overhead_model.dispatch, overhead_model.cache_warmup);
+    else if (overhead_enabled())
+        printf("\nSwitch costs are not modelled for %s.\n", algorithm_names[algo]);
+    if (resume_point != NULL && resume_point->changed_at == INT_MAX)
+        printf("\nResumed from the checkpoint at time %d; the trace is unchanged.\n", resume_point->point->time);
+    else if (resume_point != NULL)
+        printf("\nResumed from the checkpoint at time %d, before the first change at time %d.\n",
+               resume_point->point->time, resume_point->changed_at);
+    schedule(algo, processes, n, results, gantt, quantum);
+    PROFILE_TIME(PHASE_OUTPUT,
+        display_gantt_chart(gantt->entries, gantt->count, chart);
+        print_results(processes, n, results[0], results[1]);
+        print_metrics(processes, n, gantt, 1);
+        if (trace_bursts.first != NULL)
+            print_io_summary(&trace_bursts, processes, n));
+}
+
+/* Engine policy of algo under the run settings; see sched_policy(). */
+SchedPolicy algorithm_policy(Algorithm algo, int quantum) {
+    SchedConfig config = algorithm_config(algo, quantum);
+    return sched_policy(&config);
+}
+
+void schedule_smp(Algorithm algo, Process processes[], int n, float results[], GanttLog gantts[],
+                  int quantum, int cpus, SmpStats *stats) {
+    SchedPolicy policy = algorithm_policy(algo, quantum);
+
+    checked_run(simulate_smp(processes, n, &policy, cpus, gantts, stats));
+    average_times(processes, n, results);
+}
+
+/* gantts holds one log per CPU, filled by the run and owned by the caller. */
+void run_algorithm_smp(Algorithm algo, Process processes[], int n, float results[], GanttLog gantts[],
+                       int quantum, int cpus, const ChartOptions *chart) {
+    SmpStats stats;
+
+    printf("\n--- %s on %d CPUs ---\n", algorithm_titles[algo], cpus);
+    if (algo == ALGO_RR)
+        printf("\nRound Robin Scheduling with Time Quantum: %d\n", quantum);
+    schedule_smp(algo, processes, n, results, gantts, quantum, cpus, &stats);
+    for (int c = 0; c < cpus && chart->mode != CHART_NONE; c++) {
+        printf("\nCPU %d:", c);
+        if (gantts[c].count == 0)
+            printf(" idle\n");
+        display_gantt_chart(gantts[c].entries, gantts[c].count, chart);
+    }
+    print_results(processes, n, results[0], results[1]);
+    print_metrics(processes, n, gantts, cpus);
+    printf("Migrations: %lld\nSteals: %lld\n", stats.migrations, stats.steals);
+}
+
+static int parse_field(const char **cursor, const char *end, int *value) {
+    const char *c = *cursor;
+    while (c < end && (*c == ' ' || *c == '\t' || *c == ','))
+        c++;
+    int negative = 0;
+    if (c < end && (*c == '-' || *c == '+'))
+        negative = *c++ == '-';
+    if (c >= end || *c < '0' || *c > '9')
+        return 0;
+    long long v = 0;
+    while (c < end && *c >= '0' && *c <= '9') {
+        v = v * 10 + (*c++ - '0');
+        if (v > 2147483647LL)
+            return 0;
+    }
+    if (c < end && *c != ' ' && *c != '\t' && *c != ',' && *c != '\r' && *c != '\n' && *c != '/' && *c != '@')
+        return 0;
+    *value = negative ? (int)-v : (int)v;
+    *cursor = c;
+    return 1;
+}
+
+/* Extends plan->first so every process up to record starts at the current end of the steps. */
+static void plan_mark(BurstPlan *plan, int record) {
+    if (record >= plan->first_capacity) {
+        int capacity = plan->first_capacity ? plan->first_capacity : 1024;
+        while (capacity <= record)
+            capacity *= 2;
+        int *first = realloc(plan->first, capacity * sizeof(int));
+        if (first == NULL) {
+            printf("Out of memory while reading the trace.\n");
+            exit(1);
+        }
+        plan->first = first;
+        plan->first_capacity = capacity;
+    }
+    while (plan->first_count <= record)
+        plan->first[plan->first_count++] = plan->step_count;
+}
+
+static void plan_step(BurstPlan *plan, int io, int device, int cpu) {
+    if (plan->step_count == plan->step_capacity) {
+        int capacity = plan->step_capacity ? plan->step_capacity * 2 : 1024;
+        BurstStep *steps = realloc(plan->steps, capacity * sizeof(BurstStep));
+        if (steps == NULL) {
+            printf("Out of memory while reading the trace.\n");
+            exit(1);
+        }
+        plan->steps = steps;
+        plan->step_capacity = capacity;
+    }
+    BurstStep step = { io, device, cpu };
+    plan->steps[plan->step_count++] = step;
+    if (device >= plan->devices)
+        plan->devices = device + 1;
+}
+
+/*
+ * Reads the "/io[@device]/cpu" steps that follow a first CPU burst of cpu
+ * into plan as the steps of process record, and totals its CPU time in *burst.
+ */
+static int parse_burst_steps(const char **cursor, const char *eol, int cpu, BurstPlan *plan, int record, int *burst) {
+    const char *c = *cursor;
+    long long total = cpu;
+    if (cpu <= 0)
+        return 0;
+    plan_mark(plan, record);
+    plan_step(plan, 0, 0, cpu);
+    while (c < eol && *c == '/') {
+        int io, device = 0, next;
+        c++;
+        if (!parse_field(&c, eol, &io) || io <= 0)
+            return 0;
+        if (c < eol && *c == '@') {
+            c++;
+            if (!parse_field(&c, eol, &device) || device < 0 || device >= IO_MAX_DEVICES)
+                return 0;
+        }
+        if (c >= eol || *c != '/')
+            return 0;
+        c++;
+        if (!parse_field(&c, eol, &next) || next <= 0)
+            return 0;
+        plan_step(plan, io, device, next);
+        total += next;
+    }
+    if (total > INT_MAX)
+        return 0;
+    *burst = (int)total;
+    *cursor = c;
+    return 1;
+}
+
+/*
+ * Parses one "id arrival burst [priority [cpu]]" line, fields separated by
+ * commas and/or whitespace. A burst of the form 5/3@1/4 is stored in plan as
+ * the steps of process record; plan is NULL where sequences are not allowed.
+ * Returns 1 for a record, 0 for a blank line, a '#' comment or a header row
+ * (only when header_allowed), and -1 after reporting a malformed line.
+ */
+static int parse_trace_line(const char *f, const char *eol, int line, int header_allowed, Process *p,
+                            BurstPlan *plan, int record) {
+    while (f < eol && (*f == ' ' || *f == '\t' || *f == '\r'))
+        f++;
+    if (f == eol || *f == '#' || (header_allowed && !(*f >= '0' && *f <= '9') && *f != '-' && *f != '+'))
+        return 0;
+
+    int fields[5] = { 0, 0, 0, 0, -1 }, count = 0;
+    while (count < 5 && parse_field(&f, eol, &fields[count])) {
+        if (++count == 3 && f < eol && *f == '/') {
+            if (plan == NULL) {
+                fprintf(stderr, "Trace line %d: I/O bursts need the whole trace; --stream reads one process at a time.\n", line);
+                return -1;
+            }
+            if (!parse_burst_steps(&f, eol, fields[2], plan, record, &fields[2])) {
+                fprintf(stderr, "Trace line %d: bursts read cpu/io/cpu..., with positive times and an optional "
+                        "@device (0-%d) after each I/O time, as in 5/3@1/4.\n", line, IO_MAX_DEVICES - 1);
+                return -1;
+            }
+        }
+    }
+    while (f < eol && (*f == ' ' || *f == '\t' || *f == ',' || *f == '\r'))
+        f++;
+    if (count < 3 || f != eol) {
+        fprintf(stderr, "Trace line %d: expected id, arrival, burst and optional priority and CPU.\n", line);
+        return -1;
+    }
+
+    p->id = fields[0];
+    p->arrival = fields[1];
+    p->burst = fields[2];
+    p->priority = fields[3];
+    p->cpu = fields[4];
+    p->remaining_bt = p->burst;
+    p->waiting = p->tat = p->ct = 0;
+    p->rt = -1;
+    return 1;
+}
+
+/*
+ * Parses a whole trace with parse_trace_line(); a header is only recognised
+ * on the first line. Burst sequences go to plan, which the caller zeroes and
+ * frees with burst_plan_free(). Returns the number of processes, or -1 after
+ * reporting a malformed line.
+ */
+int parse_trace(const char *data, size_t size, Process **table, int *capacity, BurstPlan *plan) {
+    const char *c = data, *end = data + size;
+    int n = 0, line = 0;
+
+    while (c < end) {
+        const char *eol = memchr(c, '\n', end - c);
+        if (eol == NULL)
+            eol = end;
+        line++;
+
+        Process record;
+        int parsed = parse_trace_line(c, eol, line, n == 0 && line == 1, &record, plan, n);
+        if (parsed < 0)
+            return -1;
+        if (parsed > 0) {
+            if (n == *capacity)
+                *table = checked_reserve(*table, capacity, *capacity ? *capacity * 2 : 1024);
+            (*table)[n++] = record;
+        }
+        c = eol + 1;
+    }
+    if (plan->first != NULL)
+        plan_mark(plan, n);
+    return n;
+}
+
+void burst_plan_free(BurstPlan *plan) {
+    free(plan->first);
+    free(plan->steps);
+    memset(plan, 0, sizeof(*plan));
+}
+
+/* Maps regular files and falls back to buffered reads for pipes and stdin. */
+static int input_open(const char *path, InputFile *file) {
+    memset(file, 0, sizeof(*file));
+    int fd = STDIN_FILENO;
+    if (path != NULL && strcmp(path, "-") != 0) {
+        fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Cannot open trace %s: %s\n", path, strerror(errno));
+            return 0;
+        }
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        /* Private and writable, so a binary trace can be simulated in place. */
+        void *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            file->data = data;
+            file->size = st.st_size;
+            file->mapped = 1;
+            if (fd != STDIN_FILENO)
+                close(fd);
+            return 1;
+        }
+    }
+
+    size_t size = 0, cap = 1 << 20;
+    char *buffer = malloc(cap);
+    ssize_t got;
+    while (buffer != NULL && (got = read(fd, buffer + size, cap - size)) > 0) {
+        size += got;
+        if (size == cap) {
+            char *grown = realloc(buffer, cap * 2);
+            if (grown == NULL) {
+                free(buffer);
+                buffer = NULL;
+                break;
+            }
+            buffer = grown;
+            cap *= 2;
+        }
+    }
+    if (fd != STDIN_FILENO)
+        close(fd);
+    if (buffer == NULL) {
+        fprintf(stderr, "Out of memory while reading the trace.\n");
+        return 0;
+    }
+    file->data = buffer;
+    file->size = size;
+    return 1;
+}
+
+static void input_close(InputFile *file) {
+    if (file->mapped)
+        munmap(file->data, file->size);
+    else
+        free(file->data);
+    memset(file, 0, sizeof(*file));
+}
+
+static int binary_magic(const char *data, size_t size, const char *magic) {
+    return size >= sizeof(BinaryHeader) && memcmp(data, magic, BINARY_MAGIC_SIZE) == 0;
+}
+
+static int binary_header_ok(const BinaryHeader *h, size_t record_size) {
+    if (h->byte_order != BINARY_BYTE_ORDER) {
+        fprintf(stderr, "Binary file was written with a different byte order.\n");
+        return 0;
+    }
+    if (h->version != BINARY_VERSION) {
+        fprintf(stderr, "Unsupported binary format version %u (expected %d).\n", h->version, BINARY_VERSION);
+        return 0;
+    }
+    if (h->record_size != record_size) {
+        fprintf(stderr, "Binary records are %u bytes, expected %zu.\n", h->record_size, record_size);
+        return 0;
+    }
+    return 1;
+}
+
+/* Record count of a binary file, or -1 after reporting a bad header or size. */
+static long long binary_count(const InputFile *file, size_t record_size) {
+    BinaryHeader h;
+    memcpy(&h, file->data, sizeof(h));
+    if (!binary_header_ok(&h, record_size))
+        return -1;
+    size_t body = file->size - sizeof(h);
+    if (h.count > body / record_size || h.count * record_size != body) {
+        fprintf(stderr, "Binary file is %zu bytes, which does not match its %llu records.\n",
+                file->size, (unsigned long long)h.count);
+        return -1;
+    }
+    return (long long)h.count;
+}
+
+/* The schedulers start from the run-time fields, so they must be at their initial values. */
+static int binary_record_ok(const Process *p, long long record) {
+    if (p->remaining_bt == p->burst && p->waiting == 0 && p->tat == 0 && p->ct == 0 && p->rt == -1)
+        return 1;
+    fprintf(stderr, "Binary trace record %lld has run-time fields set.\n", record);
+    return 0;
+}
+
+/*
+ * A binary trace is used in place, and file keeps it alive until
+ * release_trace(). A CSV trace is parsed into *table and file is closed.
+ */
+static int trace_from_input(InputFile *file, Process **table, int *capacity, BurstPlan *plan) {
+    if (binary_magic(file->data, file->size, BINARY_TRACE_MAGIC)) {
+        long long count = binary_count(file, sizeof(Process));
+        if (count > INT_MAX) {
+            fprintf(stderr, "Binary trace holds more than %d processes.\n", INT_MAX);
+            count = -1;
+        }
+        Process *records = (Process *)(file->data + sizeof(BinaryHeader));
+        for (long long i = 0; i < count; i++) {
+            if (!binary_record_ok(&records[i], i + 1))
+                count = -1;
+        }
+        if (count < 0) {
+            input_close(file);
+            return -1;
+        }
+        *table = records;
+        *capacity = (int)count;
+        return (int)count;
+    }
+
+    if (file->mapped)
+        madvise(file->data, file->size, MADV_SEQUENTIAL);
+    int n = parse_trace(file->data, file->size, table, capacity, plan);
+    input_close(file);
+    return n;
+}
+
+/* Reads a CSV or binary trace into a zeroed plan; free both with release_trace(). */
+int load_trace(const char *path, Process **table, int *capacity, InputFile *file, BurstPlan *plan) {
+    if (!input_open(path, file))
+        return -1;
+    int n;
+    PROFILE_TIME(PHASE_INPUT, n = trace_from_input(file, table, capacity, plan));
+    return n;
+}
+
+void release_trace(Process *table, InputFile *file, BurstPlan *plan) {
+    if (file->data != NULL)
+        input_close(file);
+    else
+        free(table);
+    burst_plan_free(plan);
+}
+
+static void binary_header(BinaryHeader *h, const char *magic, size_t record_size, long long count) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, magic, BINARY_MAGIC_SIZE);
+    h->version = BINARY_VERSION;
+    h->byte_order = BINARY_BYTE_ORDER;
+    h->record_size = record_size;
+    h->count = count;
+}
+
+/*
+ * Writes processes as a trace that --input reads back; the CPU column only
+ * appears if a process is pinned. plan, if not NULL, supplies burst sequences.
+ */
+void write_trace_csv(const Process p[], int n, const BurstPlan *plan, FILE *out) {
+    if (plan != NULL && plan->first == NULL)
+        plan = NULL;
+    int pinned = 0;
+    for (int i = 0; i < n && !pinned; i++)
+        pinned = p[i].cpu >= 0;
+    TextBuffer *tb = tb_open(out);
+    tb_str(tb, pinned ? "id,arrival,burst,priority,cpu\n" : "id,arrival,burst,priority\n");
+    for (int i = 0; i < n; i++) {
+        tb_int(tb, p[i].id);
+        tb_str(tb, ",");
+        tb_int(tb, p[i].arrival);
+        tb_str(tb, ",");
+        if (plan != NULL && plan->first[i] < plan->first[i + 1]) {
+            tb_int(tb, plan->steps[plan->first[i]].cpu);
+            for (int k = plan->first[i] + 1; k < plan->first[i + 1]; k++) {
+                tb_str(tb, "/");
+                tb_int(tb, plan->steps[k].io);
+                if (plan->steps[k].device != 0) {
+                    tb_str(tb, "@");
+                    tb_int(tb, plan->steps[k].device);
+                }
+                tb_str(tb, "/");
+                tb_int(tb, plan->steps[k].cpu);
+            }
+        } else {
+            tb_int(tb, p[i].burst);
+        }
+        tb_str(tb, ",");
+        tb_int(tb, p[i].priority);
+        if (pinned) {
+            tb_str(tb, ",");
+            tb_int(tb, p[i].cpu);
+        }
+        tb_str(tb, "\n");
+    }
+    tb_close(tb);
+}
+
+void write_trace_binary(const Process p[], int n, FILE *out) {
+    BinaryHeader h;
+    binary_header(&h, BINARY_TRACE_MAGIC, sizeof(Process), n);
+    TextBuffer *tb = tb_open(out);
+    tb_write(tb, (const char *)&h, sizeof(h));
+    for (int i = 0; i < n; i++) {
+        Process record = p[i];
+        record.remaining_bt = record.burst;
+        record.waiting = record.tat = record.ct = 0;
+        record.rt = -1;
+        tb_write(tb, (const char *)&record, sizeof(record));
+    }
+    tb_close(tb);
+}
+
+static void gantt_csv_row(TextBuffer *tb, int cpu, int id, int start, int end) {
+    tb_int(tb, cpu);
+    tb_str(tb, ",");
+    tb_int(tb, id);
+    tb_str(tb, ",");
+    tb_int(tb, start);
+    tb_str(tb, ",");
+    tb_int(tb, end);
+    tb_str(tb, "\n");
+}
+
+void write_gantt_csv(const GanttLog gantts[], int cpus, FILE *out) {
+    TextBuffer *tb = tb_open(out);
+    tb_str(tb, "cpu,id,start,end\n");
+    for (int c = 0; c < cpus; c++) {
+        for (int e = 0; e < gantts[c].count; e++) {
+            const GanttEntry *g = &gantts[c].entries[e];
+            gantt_csv_row(tb, c, g->process_id, g->start_time, g->end_time);
+        }
+    }
+    tb_close(tb);
+}
+
+void write_gantt_binary(const GanttLog gantts[], int cpus, FILE *out) {
+    long long count = 0;
+    for (int c = 0; c < cpus; c++)
+        count += gantts[c].count;
+    BinaryHeader h;
+    binary_header(&h, BINARY_GANTT_MAGIC, sizeof(GanttRecord), count);
+    TextBuffer *tb = tb_open(out);
+    tb_write(tb, (const char *)&h, sizeof(h));
+    for (int c = 0; c < cpus; c++) {
+        for (int e = 0; e < gantts[c].count; e++) {
+            const GanttEntry *g = &gantts[c].entries[e];
+            GanttRecord record = { c, g->process_id, g->start_time, g->end_time };
+            tb_write(tb, (const char *)&record, sizeof(record));
+        }
+    }
+    tb_close(tb);
+}
+
+/*
+ * Chrome/Perfetto trace-event JSON: one complete event per segment, one
+ * thread per CPU, and one simulated time unit per microsecond.
+ */
+void write_gantt_chrome(const GanttLog gantts[], int cpus, FILE *out) {
+    TextBuffer *tb = tb_open(out);
+    tb_str(tb, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    tb_str(tb, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"scheduler\"}}");
+    for (int c = 0; c < cpus; c++) {
+        tb_str(tb, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+        tb_int(tb, c);
+        tb_str(tb, ",\"args\":{\"name\":\"CPU ");
+        tb_int(tb, c);
+        tb_str(tb, "\"}}");
+    }
+    for (int c = 0; c < cpus; c++) {
+        for (int e = 0; e < gantts[c].count; e++) {
+            const GanttEntry *g = &gantts[c].entries[e];
+            tb_str(tb, ",\n{\"name\":\"");
+            if (g->process_id == GANTT_OVERHEAD_ID)
+                tb_str(tb, "overhead");
+            else
+                tb_segment(tb, g->process_id);
+            tb_str(tb, "\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+            tb_int(tb, c);
+            tb_str(tb, ",\"ts\":");
+            tb_int(tb, g->start_time);
+            tb_str(tb, ",\"dur\":");
+            tb_int(tb, g->end_time - g->start_time);
+            tb_str(tb, "}");
+        }
+    }
+    tb_str(tb, "\n]}\n");
+    tb_close(tb);
+}
+
+void results_begin(ResultWriter *w, FILE *out, int json) {
+    memset(w, 0, sizeof(*w));
+    w->tb = tb_open(out);
+    w->json = json;
+    tb_str(w->tb, json ? "{\"processes\":[" : "id,arrival,burst,priority,completion,waiting,turnaround,response\n");
+}
+
+void results_row(ResultWriter *w, const Process *p) {
+    TextBuffer *tb = w->tb;
+    if (w->json) {
+        tb_str(tb, w->rows > 0 ? ",\n{\"id\":" : "\n{\"id\":");
+        tb_int(tb, p->id);
+        tb_str(tb, ",\"arrival\":");
+        tb_int(tb, p->arrival);
+        tb_str(tb, ",\"burst\":");
+        tb_int(tb, p->burst);
+        tb_str(tb, ",\"priority\":");
+        tb_int(tb, p->priority);
+        tb_str(tb, ",\"completion\":");
+        tb_int(tb, p->ct);
+        tb_str(tb, ",\"waiting\":");
+        tb_int(tb, p->waiting);
+        tb_str(tb, ",\"turnaround\":");
+        tb_int(tb, p->tat);
+        tb_str(tb, ",\"response\":");
+        tb_int(tb, p->rt);
+        tb_str(tb, "}");
+    } else {
+        tb_int(tb, p->id);
+        tb_str(tb, ",");
+        tb_int(tb, p->arrival);
+        tb_str(tb, ",");
+        tb_int(tb, p->burst);
+        tb_str(tb, ",");
+        tb_int(tb, p->priority);
+        tb_str(tb, ",");
+        tb_int(tb, p->ct);
+        tb_str(tb, ",");
+        tb_int(tb, p->waiting);
+        tb_str(tb, ",");
+        tb_int(tb, p->tat);
+        tb_str(tb, ",");
+        tb_int(tb, p->rt);
+        tb_str(tb, "\n");
+    }
+    w->rows++;
+    w->total_waiting += p->waiting;
+    w->total_tat += p->tat;
+    w->total_response += p->rt;
+}
+
+/* JSON output ends with a summary of the averages; CSV stays one row per process. */
+void results_end(ResultWriter *w) {
+    if (w->json) {
+        char line[160];
+        double rows = w->rows > 0 ? w->rows : 1;
+        snprintf(line, sizeof(line), "\n],\n\"summary\":{\"count\":%lld,\"average_waiting\":%.4f,"
+                 "\"average_turnaround\":%.4f,\"average_response\":%.4f}}\n",
+                 w->rows, w->total_waiting / rows, w->total_tat / rows, w->total_response / rows);
+        tb_str(w->tb, line);
+    }
+    tb_close(w->tb);
+    w->tb = NULL;
+}
+
+static int has_extension(const char *path, const char *ext) {
+    size_t len = strlen(path), ext_len = strlen(ext);
+    return len >= ext_len && strcmp(path + len - ext_len, ext) == 0;
+}
+
+static FILE *open_output(const char *path) {
+    FILE *out = fopen(path, "wb");
+    if (out == NULL)
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+    return out;
+}
+
+static int close_output(FILE *out, const char *path) {
+    int failed = ferror(out);
+    if (fclose(out) != 0 || failed) {
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+    return 1;
+}
+
+/* Writes the trace to path, as CSV if the name ends in .csv and in the binary format otherwise. */
+int save_trace(const char *path, const Process p[], int n, const BurstPlan *plan) {
+    int csv = has_extension(path, ".csv");
+    if (!csv && plan->first != NULL) {
+        fprintf(stderr, "Binary traces hold one burst per process; name the output *.csv to keep the I/O bursts.\n");
+        return 0;
+    }
+    FILE *out = open_output(path);
+    if (out == NULL)
+        return 0;
+    if (csv)
+        write_trace_csv(p, n, plan, out);
+    else
+        write_trace_binary(p, n, out);
+    return close_output(out, path);
+}
+
+/* Same for the Gantt logs of cpus CPUs, with Chrome trace-event JSON for names ending in .json. */
+int save_gantt(const char *path, const GanttLog gantts[], int cpus) {
+    FILE *out = open_output(path);
+    if (out == NULL)
+        return 0;
+    if (has_extension(path, ".csv"))
+        write_gantt_csv(gantts, cpus, out);
+    else if (has_extension(path, ".json"))
+        write_gantt_chrome(gantts, cpus, out);
+    else
+        write_gantt_binary(gantts, cpus, out);
+    return close_output(out, path);
+}
+
+/* Per-process results, as JSON if the name ends in .json and as CSV otherwise. */
+int save_results(const char *path, const Process p[], int n) {
+    FILE *out = open_output(path);
+    if (out == NULL)
+        return 0;
+    ResultWriter w;
+    results_begin(&w, out, has_extension(path, ".json"));
+    for (int i = 0; i < n; i++)
+        results_row(&w, &p[i]);
+    results_end(&w);
+    return close_output(out, path);
+}
+
+CheckpointSettings checkpoint_settings(Algorithm algo, const SchedPolicy *policy, int every) {
+    CheckpointSettings settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.algo = algo;
+    settings.quantum = policy->quantum;
+    settings.aging = policy->aging;
+    if (policy->overhead != NULL) {
+        settings.context_switch = policy->overhead->context_switch;
+        settings.dispatch = policy->overhead->dispatch;
+        settings.cache_warmup = policy->overhead->cache_warmup;
+    }
+    settings.every = every;
+    return settings;
+}
+
+/*
+ * Checkpoint file: a BinaryHeader counting the checkpoints, CheckpointSettings,
+ * the Checkpoint and CheckpointProcess records, then the finished run's
+ * process table and Gantt log. The 8-byte aligned sections come first so a
+ * mapped file is used in place.
+ */
+int save_checkpoints(const char *path, const CheckpointLog *log, CheckpointSettings settings,
+                     const Process p[], int n, const GanttLog *gantt) {
+    FILE *out = open_output(path);
+    if (out == NULL)
+        return 0;
+    BinaryHeader h;
+    binary_header(&h, BINARY_CHECKPOINT_MAGIC, sizeof(Checkpoint), log->count);
+    settings.process_count = n;
+    settings.gantt_count = gantt->count;
+    settings.record_count = log->record_count;
+    TextBuffer *tb = tb_open(out);
+    tb_write(tb, (const char *)&h, sizeof(h));
+    tb_write(tb, (const char *)&settings, sizeof(settings));
+    if (log->count > 0)
+        tb_write(tb, (const char *)log->points, log->count * sizeof(Checkpoint));
+    if (log->record_count > 0)
+        tb_write(tb, (const char *)log->records, log->record_count * sizeof(CheckpointProcess));
+    tb_write(tb, (const char *)p, n * sizeof(Process));
+    if (gantt->count > 0)
+        tb_write(tb, (const char *)gantt->entries, gantt->count * sizeof(GanttEntry));
+    tb_close(tb);
+    return close_output(out, path);
+}
+
+static int checkpoint_ok(const CheckpointFile *cf, int i) {
+    const Checkpoint *c = &cf->points[i];
+    int n = cf->settings.process_count;
+    if (c->next < 0 || c->next > n || c->active < 0 || c->active > c->next || c->running < -1 ||
+        c->running >= n || c->last_ran < -1 || c->last_ran >= n || c->last_started < -1 || c->last_started >= n ||
+        c->first_record < 0 || c->first_record + c->active > cf->settings.record_count ||
+        c->gantt_count < 0 || c->gantt_count > cf->settings.gantt_count ||
+        (i > 0 && c->time <= cf->points[i - 1].time))
+        return 0;
+    for (int r = 0; r < c->active; r++) {
+        int idx = cf->records[c->first_record + r].idx;
+        if (idx < 0 || idx >= n)
+            return 0;
+    }
+    return 1;
+}
+
+/* Maps a file written by save_checkpoints(); free it with release_checkpoints(). */
+int load_checkpoints(const char *path, CheckpointFile *cf) {
+    memset(cf, 0, sizeof(*cf));
+    if (!input_open(path, &cf->file))
+        return 0;
+    const char *data = cf->file.data;
+    size_t size = cf->file.size;
+    if (!binary_magic(data, size, BINARY_CHECKPOINT_MAGIC) || size < sizeof(BinaryHeader) + sizeof(CheckpointSettings)) {
+        fprintf(stderr, "%s is not a checkpoint file.\n", path);
+        release_checkpoints(cf);
+        return 0;
+    }
+    BinaryHeader h;
+    memcpy(&h, data, sizeof(h));
+    if (!binary_header_ok(&h, sizeof(Checkpoint))) {
+        release_checkpoints(cf);
+        return 0;
+    }
+    CheckpointSettings *s = &cf->settings;
+    memcpy(s, data + sizeof(h), sizeof(*s));
+
+    /* Bounding every count by the file size first keeps the size sum from overflowing. */
+    size_t offset = sizeof(h) + sizeof(*s);
+    if (h.count > size || s->record_count < 0 || (uint64_t)s->record_count > size || s->process_count < 0 ||
+        s->gantt_count < 0 || (uint64_t)s->gantt_count > size ||
+        offset + h.count * sizeof(Checkpoint) + s->record_count * sizeof(CheckpointProcess) +
+        (size_t)s->process_count * sizeof(Process) + s->gantt_count * sizeof(GanttEntry) != size) {
+        fprintf(stderr, "Checkpoint file is %zu bytes, which does not match its contents.\n", size);
+        release_checkpoints(cf);
+        return 0;
+    }
+    cf->count = (int)h.count;
+    cf->points = (const Checkpoint *)(data + offset);
+    cf->records = (const CheckpointProcess *)(cf->points + cf->count);
+    cf->base = (const Process *)(cf->records + s->record_count);
+    cf->gantt = (const GanttEntry *)(cf->base + s->process_count);
+    for (int i = 0; i < cf->count; i++) {
+        if (!checkpoint_ok(cf, i)) {
+            fprintf(stderr, "Checkpoint %d in %s is inconsistent.\n", i + 1, path);
+            release_checkpoints(cf);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void release_checkpoints(CheckpointFile *cf) {
+    if (cf->file.data != NULL)
+        input_close(&cf->file);
+    memset(cf, 0, sizeof(*cf));
+}
+
+/* Earliest arrival, old or new, of a process that differs between two traces by position; INT_MAX if none. */
+int first_change(const Process old[], int old_n, const Process p[], int n) {
+    int changed = INT_MAX;
+    for (int i = 0; i < old_n || i < n; i++) {
+        int arrival;
+        if (i >= n)
+            arrival = old[i].arrival;
+        else if (i >= old_n)
+            arrival = p[i].arrival;
+        else if (old[i].id != p[i].id || old[i].arrival != p[i].arrival || old[i].burst != p[i].burst ||
+                 old[i].priority != p[i].priority || old[i].cpu != p[i].cpu)
+            arrival = old[i].arrival < p[i].arrival ? old[i].arrival : p[i].arrival;
+        else
+            continue;
+        if (arrival < changed)
+            changed = arrival;
+    }
+    return changed;
+}
+
+/*
+ * Latest checkpoint taken before time, NULL if there is none. Nothing the
+ * run did up to then depends on processes arriving at time or later.
+ */
+const Checkpoint *checkpoint_before(const CheckpointFile *cf, int time) {
+    int lo = 0, hi = cf->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (cf->points[mid].time < time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo > 0 ? &cf->points[lo - 1] : NULL;
+}
+
+/* Traces convert between CSV and binary either way; binary Gantt logs convert to CSV. */
+int convert_file(const char *in_path, const char *out_path) {
+    InputFile file;
+    if (!input_open(in_path, &file))
+        return 1;
+
+    if (binary_magic(file.data, file.size, BINARY_GANTT_MAGIC)) {
+        long long count = binary_count(&file, sizeof(GanttRecord));
+        int ok = count >= 0;
+        if (ok && !has_extension(out_path, ".csv")) {
+            fprintf(stderr, "Binary Gantt logs convert to CSV; name the output *.csv.\n");
+            ok = 0;
+        }
+        FILE *out = ok ? open_output(out_path) : NULL;
+        if (out != NULL) {
+            const GanttRecord *records = (const GanttRecord *)(file.data + sizeof(BinaryHeader));
+            TextBuffer *tb = tb_open(out);
+            tb_str(tb, "cpu,id,start,end\n");
+            for (long long i = 0; i < count; i++)
+                gantt_csv_row(tb, records[i].cpu, records[i].process_id, records[i].start_time, records[i].end_time);
+            tb_close(tb);
+            ok = close_output(out, out_path);
+        } else {
+            ok = 0;
+        }
+        input_close(&file);
+        return ok ? 0 : 1;
+    }
+
+    Process *table = NULL;
+    int capacity = 0;
+    BurstPlan plan;
+    memset(&plan, 0, sizeof(plan));
+    int n = trace_from_input(&file, &table, &capacity, &plan);
+    int ok = n >= 0 && save_trace(out_path, table, n, &plan);
+    release_trace(table, &file, &plan);
+    return ok ? 0 : 1;
+}
+
+void hist_reset(Histogram *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+/* Values below HIST_SUB_COUNT get a bucket each; above that every power of two is split HIST_SUB_COUNT ways. */
+static int hist_index(int value) {
+    if (value < HIST_SUB_COUNT)
+        return value;
+    int shift = 31 - __builtin_clz((unsigned)value) - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB_COUNT + (value >> shift) - HIST_SUB_COUNT;
+}
+
+static int hist_upper_bound(int index) {
+    if (index < HIST_SUB_COUNT)
+        return index;
+    int shift = index / HIST_SUB_COUNT - 1;
+    long long upper = ((long long)(index % HIST_SUB_COUNT + HIST_SUB_COUNT + 1) << shift) - 1;
+    return upper > INT_MAX ? INT_MAX : (int)upper;
+}
+
+void hist_record(Histogram *h, int value) {
+    if (value < 0)
+        value = 0;
+    h->counts[hist_index(value)]++;
+    h->total++;
+    h->sum += value;
+    if (value > h->max)
+        h->max = value;
+}
+
+double hist_mean(const Histogram *h) {
+    return h->total ? h->sum / h->total : 0;
+}
+
+/* Highest value in the bucket holding the given percentile, capped at the largest value seen. */
+int hist_percentile(const Histogram *h, double percentile) {
+    if (h->total == 0)
+        return 0;
+    long long rank = (long long)ceil(percentile / 100.0 * h->total);
+    if (rank < 1)
+        rank = 1;
+    long long seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            int upper = hist_upper_bound(i);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+void print_percentiles(const char *label, const Histogram *h) {
+    printf("%-12s %10.2f %10d %10d %10d %10d %10d\n", label, hist_mean(h),
+           hist_percentile(h, 50), hist_percentile(h, 90), hist_percentile(h, 99),
+           hist_percentile(h, 99.9), h->max);
+}
+
+void print_latency_table(const Histogram *waiting, const Histogram *tat, const Histogram *response) {
+    printf("\n%-12s %10s %10s %10s %10s %10s %10s\n", "", "avg", "p50", "p90", "p99", "p99.9", "max");
+    print_percentiles("Waiting", waiting);
+    print_percentiles("Turnaround", tat);
+    print_percentiles("Response", response);
+}
+
+/* busy counts useful work only; overhead is reported beside it when there is any. */
+void print_throughput(long long completed, long long busy, int first_arrival, int last_completion,
+                      int cpus, long long switches, long long overhead) {
+    double span = (double)last_completion - first_arrival;
+    printf("\nThroughput: %.4f processes per time unit\n", span > 0 ? completed / span : 0);
+    printf("CPU Utilization: %.2f%%\n", span > 0 ? 100.0 * busy / (span * cpus) : 0);
+    printf("Context Switches: %lld\n", switches);
+    if (overhead > 0) {
+        printf("Useful Work: %lld time units\n", busy);
+        printf("Overhead: %lld time units (%.2f%% of CPU time in use)\n", overhead,
+               100.0 * overhead / (busy + overhead));
+    }
+}
+
+/* Answers --at and --busy from each CPU's log; -1 leaves a query out. */
+void print_timeline_queries(const GanttLog gantts[], int cpus, int at, int busy_from, int busy_to) {
+    printf("\n");
+    for (int c = 0; c < cpus; c++) {
+        char cpu[32] = "";
+        Timeline tl;
+        checked_run(timeline_build(&tl, &gantts[c]));
+        if (cpus > 1)
+            snprintf(cpu, sizeof(cpu), " on CPU %d", c);
+        if (at >= 0) {
+            const GanttEntry *g = timeline_at(&tl, at);
+            if (g == NULL)
+                printf("At time %d%s: idle\n", at, cpu);
+            else if (g->process_id == GANTT_OVERHEAD_ID)
+                printf("At time %d%s: switch overhead (%d-%d)\n", at, cpu, g->start_time, g->end_time);
+            else
+                printf("At time %d%s: P%d (%d-%d)\n", at, cpu, g->process_id, g->start_time, g->end_time);
+        }
+        if (busy_from >= 0) {
+            long long busy = timeline_busy(&tl, busy_from, busy_to);
+            printf("Busy over [%d, %d)%s: %lld of %d time units, %.2f%%\n", busy_from, busy_to, cpu, busy,
+                   busy_to - busy_from, 100.0 * busy / (busy_to - busy_from));
+        }
+        timeline_free(&tl);
+    }
+}
+
+/*
+ * Percentiles, throughput, utilisation and context switches of a finished
+ * run. gantts holds one log per CPU; a switch is a segment whose process
+ * differs from the one before it on the same CPU, overhead segments aside.
+ */
+void print_metrics(Process processes[], int n, const GanttLog gantts[], int cpus) {
+    Histogram *h = checked_alloc(3 * sizeof(Histogram));
+    long long busy = 0, switches = 0, overhead = 0;
+    int first = INT_MAX, last = 0;
+
+    for (int k = 0; k < 3; k++)
+        hist_reset(&h[k]);
+    for (int i = 0; i < n; i++) {
+        hist_record(&h[0], processes[i].waiting);
+        hist_record(&h[1], processes[i].tat);
+        hist_record(&h[2], processes[i].rt);
+        busy += processes[i].burst;
+        if (processes[i].arrival < first)
+            first = processes[i].arrival;
+        if (processes[i].ct > last)
+            last = processes[i].ct;
+    }
+    for (int c = 0; c < cpus; c++) {
+        int previous = -1;
+        for (int e = 0; e < gantts[c].count; e++) {
+            const GanttEntry *g = &gantts[c].entries[e];
+            if (g->process_id == GANTT_OVERHEAD_ID) {
+                overhead += g->end_time - g->start_time;
+                continue;
+            }
+            if (previous != -1 && g->process_id != gantts[c].entries[previous].process_id)
+                switches++;
+            previous = e;
+        }
+    }
+
+    print_latency_table(&h[0], &h[1], &h[2]);
+    print_throughput(n, busy, first, last, cpus, switches, overhead);
+    free(h);
+}
+
+/* Time processes spent on I/O, which waiting time leaves out, and how busy each device was. */
+void print_io_summary(const BurstPlan *plan, const Process p[], int n) {
+    long long *busy = checked_alloc(plan->devices * sizeof(long long));
+    long long *requests = checked_alloc(plan->devices * sizeof(long long));
+    memset(busy, 0, plan->devices * sizeof(long long));
+    memset(requests, 0, plan->devices * sizeof(long long));
+    double blocked = 0;
+    int first = INT_MAX, last = 0;
+
+    for (int i = 0; i < n; i++) {
+        blocked += p[i].tat - p[i].burst - p[i].waiting;
+        if (p[i].arrival < first)
+            first = p[i].arrival;
+        if (p[i].ct > last)
+            last = p[i].ct;
+        for (int k = plan->first[i] + 1; k < plan->first[i + 1]; k++) {
+            busy[plan->steps[k].device] += plan->steps[k].io;
+            requests[plan->steps[k].device]++;
+        }
+    }
+
+    double span = (double)last - first;
+    printf("\nAverage I/O Time: %.2f\n", blocked / n);
+    for (int d = 0; d < plan->devices; d++) {
+        printf("Device %d: %lld requests, %.2f%% utilization\n", d, requests[d],
+               span > 0 ? 100.0 * busy[d] / span : 0);
+    }
+    free(busy);
+    free(requests);
+}
+
+#ifdef SCHED_PROFILE
+__thread Profile profile;
+static Profile profile_total;
+static pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long long profile_started;
+static unsigned long long profile_clock_cost;
+static unsigned long long profile_probe_cost;    /* what timing a phase adds to the time around it */
+
+/* Ticks since start, less what reading the clock itself costs. */
+unsigned long long profile_elapsed(unsigned long long start) {
+    unsigned long long ticks = profile_clock() - start;
+    return ticks > profile_clock_cost ? ticks - profile_clock_cost : 0;
+}
+
+/* Ends the sample the run was taking, if any. */
+static void profile_event_end(ProfileRun *run) {
+    if (run->weight != 0) {
+        profile.ticks[PHASE_SAMPLED] += profile_elapsed(run->event_start) * run->weight;
+        profile.clock_reads += 2;
+        run->weight = 0;
+    }
+}
+
+/* Counts the events since the last call and decides whether the one starting now is sampled. */
+void profile_event(ProfileRun *run) {
+    profile_event_end(run);
+    unsigned long long event = (run->counts[COUNT_EVENTS] += run->period) - 1;
+    if (event < PROFILE_SAMPLE_EVERY)
+        run->weight = 1;
+    else if (event % PROFILE_SAMPLE_EVERY == 0)
+        run->weight = PROFILE_SAMPLE_EVERY;
+    run->period = run->countdown = run->weight != 0 ? 1 : PROFILE_SAMPLE_EVERY - 1;
+    if (run->weight != 0)
+        run->event_start = profile_clock();
+}
+
+void profile_sample(ProfileRun *run, ProfilePhase phase, unsigned long long start) {
+    profile.ticks[phase] += profile_elapsed(start) * run->weight;
+    profile.probes += run->weight;
+    profile.clock_reads += 2;
+}
+
+void profile_run_end(ProfileRun *run) {
+    profile_event_end(run);
+    run->counts[COUNT_EVENTS] += run->period - run->countdown;
+    for (int k = 0; k < COUNTER_COUNT; k++)
+        profile.counts[k] += run->counts[k];
+}
+
+static void profile_row(const char *label, unsigned long long ticks, unsigned long long elapsed) {
+    fprintf(stderr, "%-22s %16llu %8.2f%%\n", label, ticks, elapsed ? 100.0 * ticks / elapsed : 0.0);
+}
+
+static double profile_ratio(unsigned long long a, unsigned long long b) {
+    return b ? (double)a / b : 0.0;
+}
+
+/* The part of the engine's event loop time that phase took in the sampled events, probes left out. */
+static unsigned long long profile_share(const Profile *t, ProfilePhase phase, unsigned long long loop) {
+    double sampled = (double)t->ticks[PHASE_SAMPLED] - (double)t->probes * profile_probe_cost;
+    if (sampled <= 0)
+        sampled = t->ticks[PHASE_SAMPLED];
+    return sampled > 0 ? (unsigned long long)(loop * (t->ticks[phase] / sampled)) : 0;
+}
+
+/*
+ * Shares are of the main thread's wall time; worker threads add their
+ * own time on top, so with --compare or --tune they can pass 100%. The
+ * arrival sort is timed in full. The profiler row is what reading the
+ * clock cost inside the engine, and the rest of its time is split between
+ * the per-event phases as the sampled events were.
+ */
+static void profile_report(void) {
+    profile_flush();
+    const Profile *t = &profile_total;
+    const unsigned long long *c = t->counts;
+    unsigned long long elapsed = profile_clock() - profile_started;
+    unsigned long long loop = t->ticks[PHASE_ENGINE] > t->ticks[PHASE_SORT] ? t->ticks[PHASE_ENGINE] - t->ticks[PHASE_SORT] : 0;
+    unsigned long long probes = t->clock_reads * profile_probe_cost / 2;
+    if (probes > loop)
+        probes = loop;
+    loop -= probes;
+    unsigned long long admit = profile_share(t, PHASE_ADMIT, loop), select = profile_share(t, PHASE_SELECT, loop);
+    unsigned long long gantt = profile_share(t, PHASE_GANTT, loop), inner = admit + select + gantt;
+    /*
+     * An event starts with a dispatch unless it idles, resumes a process an
+     * arrival left running, or lost the CPU during overhead. Every event
+     * scans for arrivals on entry, all but idle ones again before deciding,
+     * and dispatches that pay overhead once more after it.
+     */
+    unsigned long long dispatches = c[COUNT_EVENTS] - c[COUNT_IDLE_JUMPS] - c[COUNT_KEPT] - c[COUNT_SWITCH_PREEMPTIONS];
+    unsigned long long scans = 2 * c[COUNT_EVENTS] - c[COUNT_IDLE_JUMPS] - c[COUNT_SWITCH_PREEMPTIONS] + c[COUNT_CHARGED];
+
+    fprintf(stderr, "\n--- Profile (%s, all threads) ---\n", PROFILE_UNIT);
+    profile_row("input", t->ticks[PHASE_INPUT], elapsed);
+    profile_row("engine", t->ticks[PHASE_ENGINE], elapsed);
+    profile_row("  arrival sort", t->ticks[PHASE_SORT], elapsed);
+    profile_row("  admit", admit, elapsed);
+    profile_row("  select", select, elapsed);
+    profile_row("  gantt", gantt, elapsed);
+    profile_row("  rest of engine", loop > inner ? loop - inner : 0, elapsed);
+    profile_row("  profiler", probes, elapsed);
+    profile_row("output", t->ticks[PHASE_OUTPUT], elapsed);
+    profile_row("whole run", elapsed, elapsed);
+    fprintf(stderr, "Engine runs: %llu, events: %llu, dispatches: %llu, overhead charges: %llu\n",
+            c[COUNT_RUNS], c[COUNT_EVENTS], dispatches, c[COUNT_CHARGED]);
+    fprintf(stderr, "Preemptions: %llu (%llu during overhead), quantum expiries: %llu, I/O blocks: %llu\n",
+            c[COUNT_PREEMPTIONS] + c[COUNT_SWITCH_PREEMPTIONS], c[COUNT_SWITCH_PREEMPTIONS],
+            c[COUNT_EXPIRIES], c[COUNT_IO_BLOCKS]);
+    fprintf(stderr, "Idle jumps: %llu, skipping %llu time units\n", c[COUNT_IDLE_JUMPS], c[COUNT_IDLE_SKIPPED]);
+    fprintf(stderr, "Admit scans: %llu, %.2f arrivals and I/O wake-ups queued per scan\n",
+            scans, profile_ratio(c[COUNT_ADMITTED] + c[COUNT_IO_BLOCKS], scans));
+}
+
+void profile_init(void) {
+    profile_clock_cost = ULLONG_MAX;
+    for (int k = 0; k < 1000; k++) {
+        unsigned long long start = profile_clock();
+        unsigned long long ticks = profile_clock() - start;
+        if (ticks < profile_clock_cost)
+            profile_clock_cost = ticks;
+    }
+    /* Timed the way the engine times a phase, with nothing in it. */
+    profile_probe_cost = ULLONG_MAX;
+    for (int k = 0; k < 100; k++) {
+        volatile unsigned long long sink = 0;
+        unsigned long long start = profile_clock();
+        for (int i = 0; i < 16; i++) {
+            unsigned long long probe = profile_clock();
+            sink += profile_elapsed(probe);
+        }
+        unsigned long long ticks = (profile_clock() - start) / 16;
+        if (ticks < profile_probe_cost)
+            profile_probe_cost = ticks;
+    }
+    profile_started = profile_clock();
+    atexit(profile_report);
+}
+
+/* Adds this thread's counts to the total and clears them. */
+void profile_flush(void) {
+    pthread_mutex_lock(&profile_lock);
+    for (int k = 0; k < PHASE_COUNT; k++)
+        profile_total.ticks[k] += profile.ticks[k];
+    for (int k = 0; k < COUNTER_COUNT; k++)
+        profile_total.counts[k] += profile.counts[k];
+    profile_total.probes += profile.probes;
+    profile_total.clock_reads += profile.clock_reads;
+    pthread_mutex_unlock(&profile_lock);
+    memset(&profile, 0, sizeof(profile));
+}
+#endif
+
+StreamReader *stream_open(const char *path) {
+    int fd = STDIN_FILENO;
+    if (path != NULL && strcmp(path, "-") != 0) {
+        fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Cannot open trace %s: %s\n", path, strerror(errno));
+            return NULL;
+        }
+    }
+    StreamReader *in = checked_alloc(sizeof(StreamReader));
+    memset(in, 0, sizeof(*in));
+    in->fd = fd;
+    in->capacity = STREAM_BUFFER_SIZE;
+    in->data = checked_alloc(in->capacity);
+    return in;
+}
+
+void stream_close(StreamReader *in) {
+    if (in->fd != STDIN_FILENO)
+        close(in->fd);
+    free(in->data);
+    free(in);
+}
+
+/*
+ * Reads until need unread bytes are buffered or the input ends, keeping only
+ * the unread part and growing the buffer if it alone fills it.
+ */
+static int stream_fill(StreamReader *in, size_t need) {
+    while (in->len - in->pos < need && !in->eof) {
+        memmove(in->data, in->data + in->pos, in->len - in->pos);
+        in->len -= in->pos;
+        in->pos = 0;
+        if (in->len == in->capacity) {
+            in->capacity *= 2;
+            in->data = realloc(in->data, in->capacity);
+            if (in->data == NULL) {
+                fprintf(stderr, "Out of memory while reading the trace.\n");
+                exit(1);
+            }
+        }
+        ssize_t got = read(in->fd, in->data + in->len, in->capacity - in->len);
+        if (got <= 0)
+            in->eof = 1;
+        else
+            in->len += got;
+    }
+    return in->len - in->pos >= need;
+}
+
+/*
+ * Switches to binary records if the input starts with a trace header. Bytes
+ * are only awaited while they still match the magic, so a live text stream
+ * with a short first line is not held up. Returns 0 on a bad header.
+ */
+static int stream_detect(StreamReader *in) {
+    for (size_t k = 1; k <= BINARY_MAGIC_SIZE; k++) {
+        if (!stream_fill(in, k) || in->data[in->pos + k - 1] != BINARY_TRACE_MAGIC[k - 1])
+            return 1;
+    }
+    BinaryHeader h;
+    if (!stream_fill(in, sizeof(h))) {
+        fprintf(stderr, "Binary trace header is truncated.\n");
+        return 0;
+    }
+    memcpy(&h, in->data + in->pos, sizeof(h));
+    if (!binary_header_ok(&h, sizeof(Process)))
+        return 0;
+    in->pos += sizeof(h);
+    in->binary = 1;
+    return 1;
+}
+
+/* Reads the next process. Returns 1 on success, 0 at the end of the input and -1 on a bad line. */
+int stream_next(StreamReader *in, Process *p) {
+    if (!in->started) {
+        in->started = 1;
+        if (!stream_detect(in))
+            return -1;
+    }
+    if (in->binary) {
+        if (!stream_fill(in, sizeof(Process))) {
+            if (in->pos == in->len)
+                return 0;
+            fprintf(stderr, "Binary trace ends in a partial record.\n");
+            return -1;
+        }
+        memcpy(p, in->data + in->pos, sizeof(Process));
+        in->pos += sizeof(Process);
+        in->line++;
+        in->records++;
+        return binary_record_ok(p, in->records) ? 1 : -1;
+    }
+
+    while (1) {
+        char *start = in->data + in->pos;
+        char *eol = memchr(start, '\n', in->len - in->pos);
+        if (eol == NULL && !in->eof) {
+            stream_fill(in, in->len - in->pos + 1);
+            continue;
+        }
+        if (eol == NULL) {
+            if (in->pos == in->len)
+                return 0;
+            eol = in->data + in->len;
+        }
+
+        in->line++;
+        in->pos = eol - in->data + (eol < in->data + in->len);
+        int parsed = parse_trace_line(start, eol, in->line, in->line == 1, p, NULL, 0);
+        if (parsed < 0)
+            return -1;
+        if (parsed > 0) {
+            in->records++;
+            return 1;
+        }
+    }
+}
+
+static void report_stream(const StreamStats *st, FILE *out) {
+    fprintf(out, "t=%d done=%lld in_flight=%d waiting avg=%.2f p50=%d p99=%d max=%d "
+            "tat avg=%.2f p50=%d p99=%d max=%d\n",
+            st->now, st->completed, st->source.in_flight,
+            hist_mean(&st->waiting), hist_percentile(&st->waiting, 50),
+            hist_percentile(&st->waiting, 99), st->waiting.max,
+            hist_mean(&st->tat), hist_percentile(&st->tat, 50),
+            hist_percentile(&st->tat, 99), st->tat.max);
+    fflush(out);
+}
+
+/* Reads the next arrival for the engine; the first one starts the clock. */
+static int stream_arrival(void *ctx, Process *p) {
+    StreamStats *st = ctx;
+    int have = stream_next(st->in, p);
+    if (have > 0 && st->source.peak_in_flight == 0)
+        st->now = st->first_arrival = p->arrival;
+    return have;
+}
+
+static void stream_finished(void *ctx, const Process *p) {
+    StreamStats *st = ctx;
+    hist_record(&st->waiting, p->waiting);
+    hist_record(&st->tat, p->tat);
+    hist_record(&st->response, p->rt);
+    if (st->results != NULL)
+        results_row(st->results, p);
+    st->busy += p->burst;
+    st->completed++;
+    st->now = p->ct;
+    if (st->report_every > 0 && st->completed % st->report_every == 0)
+        report_stream(st, stdout);
+}
+
+/* results_out, when set, receives one result row per process as it finishes. */
+int run_stream(const char *path, Algorithm algo, int quantum, long long report_every, const char *results_out) {
+    ResultWriter results;
+    FILE *out = NULL;
+    if (results_out != NULL) {
+        out = open_output(results_out);
+        if (out == NULL)
+            return 1;
+        results_begin(&results, out, has_extension(results_out, ".json"));
+    }
+    StreamReader *in = stream_open(path);
+    if (in == NULL) {
+        if (out != NULL) {
+            results_end(&results);
+            fclose(out);
+        }
+        return 1;
+    }
+    SchedPolicy policy = algorithm_policy(algo, quantum);
+    StreamStats *st = checked_alloc(sizeof(StreamStats));
+    memset(st, 0, sizeof(*st));
+    SchedStream source = { stream_arrival, stream_finished, st, 0, 0, 0, 0 };
+    st->source = source;
+    st->in = in;
+    st->results = out != NULL ? &results : NULL;
+    st->report_every = report_every;
+
+    printf("\n--- %s (streaming) ---\n", algorithm_titles[algo]);
+    if (algo == ALGO_RR)
+        printf("\nRound Robin Scheduling with Time Quantum: %d\n", quantum);
+    SchedStatus status = simulate_stream(&st->source, &policy);
+    /* stream_next() has already reported a line it could not read. */
+    if (status == SCHED_ERR_CONFIG)
+        fprintf(stderr, "Trace line %d: arrivals must be non-negative and in order, bursts positive, "
+                "priorities non-negative, and the stream must finish by time %d.\n", in->line, INT_MAX);
+    else if (status == SCHED_ERR_MEMORY)
+        printf("%s\n", sched_strerror(status));
+    int ok = status == SCHED_OK;
+    stream_close(in);
+    if (out != NULL) {
+        results_end(&results);
+        if (!close_output(out, results_out))
+            ok = 0;
+    }
+    if (!ok) {
+        free(st);
+        return 1;
+    }
+
+    printf("\nProcesses completed: %lld\nPeak in flight: %d\nFinished at: %d\n",
+           st->completed, st->source.peak_in_flight, st->now);
+    print_latency_table(&st->waiting, &st->tat, &st->response);
+    print_throughput(st->completed, st->busy, st->first_arrival, st->now, 1, st->source.switches,
+                     st->source.overhead);
+    free(st);
+    return 0;
+}
+
+const char *rt_policy_names[RT_COUNT] = { "edf", "rm" };
+const char *rt_policy_titles[RT_COUNT] = { "Earliest Deadline First Scheduling", "Rate-Monotonic Scheduling" };
+
+int rt_policy_from_name(const char *name) {
+    for (int r = 0; r < RT_COUNT; r++) {
+        if (strcmp(name, rt_policy_names[r]) == 0)
+            return r;
+    }
+    return -1;
+}
+
+/*
+ * Parses one "id period wcet [deadline [phase [jitter]]]" task line, fields
+ * separated like trace lines; the deadline defaults to the period. Returns 1
+ * for a task, 0 for a blank, comment or header line (only when
+ * header_allowed), and -1 after reporting a malformed line.
+ */
+static int parse_task_line(const char *f, const char *eol, int line, int header_allowed, RtTask *task) {
+    while (f < eol && (*f == ' ' || *f == '\t' || *f == '\r'))
+        f++;
+    if (f == eol || *f == '#' || (header_allowed && !(*f >= '0' && *f <= '9') && *f != '-' && *f != '+'))
+        return 0;
+
+    int fields[6] = { 0, 0, 0, 0, 0, 0 }, count = 0;
+    while (count < 6 && parse_field(&f, eol, &fields[count]))
+        count++;
+    while (f < eol && (*f == ' ' || *f == '\t' || *f == ',' || *f == '\r'))
+        f++;
+    if (count < 3 || f != eol) {
+        fprintf(stderr, "Task line %d: expected id, period, WCET and optional deadline, phase and jitter.\n", line);
+        return -1;
+    }
+
+    task->id = fields[0];
+    task->period = fields[1];
+    task->wcet = fields[2];
+    task->deadline = count > 3 ? fields[3] : fields[1];
+    task->phase = fields[4];
+    task->jitter = fields[5];
+    if (task->period <= 0 || task->wcet <= 0 || task->deadline <= 0 || task->phase < 0 || task->jitter < 0) {
+        fprintf(stderr, "Task line %d: period, WCET and deadline must be positive, phase and jitter "
+                "non-negative.\n", line);
+        return -1;
+    }
+    return 1;
+}
+
+/* Reads a task set into *tasks, which the caller frees; returns the task count or -1 after an error. */
+int load_tasks(const char *path, RtTask **tasks) {
+    InputFile file;
+    if (!input_open(path, &file))
+        return -1;
+    const char *c = file.data, *end = file.data + file.size;
+    int n = 0, capacity = 0, line = 0;
+
+    while (c < end) {
+        const char *eol = memchr(c, '\n', end - c);
+        if (eol == NULL)
+            eol = end;
+        line++;
+
+        RtTask task;
+        int parsed = parse_task_line(c, eol, line, n == 0 && line == 1, &task);
+        if (parsed < 0) {
+            input_close(&file);
+            return -1;
+        }
+        if (parsed > 0) {
+            if (n == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                RtTask *grown = realloc(*tasks, capacity * sizeof(RtTask));
+                if (grown == NULL) {
+                    printf("Out of memory while reading the task set.\n");
+                    exit(1);
+                }
+                *tasks = grown;
+            }
+            (*tasks)[n++] = task;
+        }
+        c = eol + 1;
+    }
+    input_close(&file);
+    return n;
+}
+
+void print_rt_results(const RtTask tasks[], int n, const RtStats *st) {
+    long long max_lateness = LLONG_MIN;
+    printf("\nTask\tPeriod\tWCET\tDeadline\tJobs\tMissed\tMax Lateness\tAvg Response\tMax Response\n");
+    for (int t = 0; t < n; t++) {
+        const RtTaskStats *ts = &st->tasks[t];
+        if (ts->jobs == 0) {
+            printf("%d\t%d\t%d\t%d\t\t0\t0\t-\t\t-\t\t-\n", tasks[t].id, tasks[t].period, tasks[t].wcet,
+                   tasks[t].deadline);
+            continue;
+        }
+        printf("%d\t%d\t%d\t%d\t\t%lld\t%lld\t%lld\t\t%.2f\t\t%d\n", tasks[t].id, tasks[t].period,
+               tasks[t].wcet, tasks[t].deadline, ts->jobs, ts->missed, ts->max_lateness,
+               (double)ts->total_response / ts->jobs, ts->max_response);
+        if (ts->max_lateness > max_lateness)
+            max_lateness = ts->max_lateness;
+    }
+
+    double span = (double)st->finished - st->first_release;
+    printf("\nJobs: %lld\n", st->jobs);
+    printf("Deadline Misses: %lld (%.2f%%)\n", st->missed, st->jobs ? 100.0 * st->missed / st->jobs : 0);
+    if (st->jobs > 0)
+        printf("Maximum Lateness: %lld\n", max_lateness);
+    if (st->missed > 0)
+        printf("Average Tardiness of Late Jobs: %.2f\n", (double)st->tardiness / st->missed);
+    printf("Preemptions: %lld\n", st->preemptions);
+    printf("CPU Utilization: %.2f%%\n", span > 0 ? 100.0 * st->busy / span : 0);
+    printf("Peak Pending Jobs: %d\n", st->peak_pending);
+}
+
+/*
+ * Utilization tests. EDF meets every deadline if the density, the sum of
+ * wcet / min(deadline, period), is at most 1, and cannot once the
+ * utilization exceeds 1. With deadlines equal to periods RM meets every
+ * deadline within the Liu & Layland bound n(2^(1/n) - 1) or the hyperbolic
+ * bound, the product of (U_i + 1) at most 2. Both RM bounds are sufficient
+ * only.
+ */
+void print_rt_bounds(const RtTask tasks[], int n, RtPolicy policy) {
+    double utilization = 0, density = 0, product = 1;
+    int implicit = 1;
+    for (int t = 0; t < n; t++) {
+        double u = (double)tasks[t].wcet / tasks[t].period;
+        utilization += u;
+        density += (double)tasks[t].wcet / (tasks[t].deadline < tasks[t].period ? tasks[t].deadline : tasks[t].period);
+        product *= u + 1;
+        implicit = implicit && tasks[t].deadline == tasks[t].period;
+    }
+
+    printf("\nUtilization: %.4f\nDensity: %.4f\n", utilization, density);
+    if (utilization > 1 + 1e-9) {
+        printf("Overloaded: utilization above 1 misses deadlines under any policy.\n");
+        return;
+    }
+    if (policy == RT_EDF) {
+        printf("EDF bound (density <= 1): %s\n", density <= 1 + 1e-9 ? "met, every deadline is met" :
+               "not met, deadlines may be missed");
+        return;
+    }
+    double liu_layland = n * (pow(2.0, 1.0 / n) - 1);
+    int met = utilization <= liu_layland + 1e-9 || product <= 2 + 1e-9;
+    printf("RM Liu & Layland bound (utilization <= %.4f): %s\n", liu_layland,
+           utilization <= liu_layland + 1e-9 ? "met" : "not met");
+    printf("RM hyperbolic bound (product of U_i + 1 = %.4f <= 2): %s\n", product, product <= 2 + 1e-9 ? "met" : "not met");
+    if (!implicit)
+        printf("The RM bounds assume deadlines equal to periods, which not every task has.\n");
+    else if (met)
+        printf("Every deadline is met.\n");
+    else
+        printf("The RM bounds are sufficient only; the simulation shows whether deadlines are missed.\n");
+}
+
+/* Least common multiple of the periods, or -1 once it passes limit. */
+static long long hyperperiod(const RtTask tasks[], int n, long long limit) {
+    long long lcm = 1;
+    for (int t = 0; t < n; t++) {
+        long long a = lcm, b = tasks[t].period;
+        while (b != 0) {
+            long long r = a % b;
+            a = b;
+            b = r;
+        }
+        lcm = lcm / a * tasks[t].period;
+        if (lcm > limit)
+            return -1;
+    }
+    return lcm;
+}
+
+/*
+ * Simulates the task set in path up to horizon, 0 = its largest phase plus
+ * one hyperperiod. gantt_out, if set, receives the Gantt log.
+ */
+int run_realtime(const char *path, RtPolicy policy, int horizon, unsigned long long seed, const ChartOptions *chart,
+                 const char *gantt_out) {
+    RtTask *tasks = NULL;
+    int n = load_tasks(path, &tasks);
+    if (n <= 0) {
+        if (n == 0)
+            fprintf(stderr, "The task set is empty.\n");
+        free(tasks);
+        return 1;
+    }
+
+    long long hyper = hyperperiod(tasks, n, RT_HORIZON_LIMIT);
+    long long max_phase = 0;
+    for (int t = 0; t < n; t++) {
+        if (tasks[t].phase > max_phase)
+            max_phase = tasks[t].phase;
+    }
+    if (horizon == 0) {
+        if (hyper < 0 || max_phase + hyper > RT_HORIZON_LIMIT) {
+            fprintf(stderr, "The hyperperiod of this task set passes %d time units; choose a --horizon.\n",
+                    RT_HORIZON_LIMIT);
+            free(tasks);
+            return 2;
+        }
+        horizon = (int)(max_phase + hyper);
+    }
+    /* Late jobs still run, so the last one finishes by the horizon plus all the work released before it. */
+    long long end = horizon;
+    for (int t = 0; t < n; t++) {
+        if (tasks[t].phase < horizon)
+            end += ((long long)horizon - tasks[t].phase + tasks[t].period - 1) / tasks[t].period * tasks[t].wcet;
+    }
+    if (end > INT_MAX) {
+        fprintf(stderr, "The task set releases more work before time %d than a run can time; choose a shorter "
+                "--horizon.\n", horizon);
+        free(tasks);
+        return 2;
+    }
+
+    printf("\n--- %s ---\n", rt_policy_titles[policy]);
+    printf("\nTasks: %d, releases before time %d", n, horizon);
+    if (hyper > 0)
+        printf(" (hyperperiod %lld)", hyper);
+    printf("\n");
+
+    GanttLog gantt = { NULL, 0, 0, 0, 0 };
+    RtStats st;
+    memset(&st, 0, sizeof(st));
+    st.tasks = checked_alloc(n * sizeof(RtTaskStats));
+    memset(st.tasks, 0, n * sizeof(RtTaskStats));
+    /* Without a chart or --gantt-out nothing keeps per-job state, however many jobs there are. */
+    GanttLog *log = chart->mode != CHART_NONE || gantt_out != NULL ? &gantt : NULL;
+    PROFILE_TIME(PHASE_ENGINE, checked_run(simulate_realtime(tasks, n, policy, horizon, seed, log, &st)));
+    PROFILE_TIME(PHASE_OUTPUT,
+        display_gantt_chart(gantt.entries, gantt.count, chart);
+        print_rt_results(tasks, n, &st);
+        print_rt_bounds(tasks, n, policy));
+
+    int status = 0;
+    if (gantt_out != NULL && !save_gantt(gantt_out, &gantt, 1))
+        status = 1;
+    gantt_free(&gantt);
+    free(st.tasks);
+    free(tasks);
+    return status;
+}
+
+typedef struct {
+    Algorithm algo;
+    int quantum;
+    double avg_waiting;
+    double avg_tat;
+    double avg_response;
+    int p99_waiting;
+    int p99_response;
+} CompareJob;
+
+typedef struct {
+    Process *input;
+    int n;
+    CompareJob *jobs;
+    int job_count;
+    int next_job;
+    int cpus;
+    pthread_mutex_t lock;
+} ComparePool;
+
+/* Runs one job on a fresh copy of input and fills in its metrics; h holds two scratch histograms. */
+static void run_compare_job(CompareJob *job, Process *input, Process *copy, int n, int cpus,
+                            GanttLog *gantt, Histogram *h) {
+    float results[2];
+    reset_processes(copy, input, n);
+    gantt_reset(gantt);
+    if (cpus > 1) {
+        SmpStats stats;
+        schedule_smp(job->algo, copy, n, results, NULL, job->quantum, cpus, &stats);
+    } else {
+        schedule(job->algo, copy, n, results, gantt, job->quantum);
+    }
+
+    double total_wt = 0, total_tat = 0, total_rt = 0;
+    hist_reset(&h[0]);
+    hist_reset(&h[1]);
+    for (int i = 0; i < n; i++) {
+        total_wt += copy[i].waiting;
+        total_tat += copy[i].tat;
+        total_rt += copy[i].rt;
+        hist_record(&h[0], copy[i].waiting);
+        hist_record(&h[1], copy[i].rt);
+    }
+    job->avg_waiting = total_wt / n;
+    job->avg_tat = total_tat / n;
+    job->avg_response = total_rt / n;
+    job->p99_waiting = hist_percentile(&h[0], 99);
+    job->p99_response = hist_percentile(&h[1], 99);
+}
+
+/* Each worker keeps its own process copy and Gantt log for all of its jobs. */
+static void *compare_worker(void *arg) {
+    ComparePool *pool = arg;
+    int n = pool->n;
+    Process *copy = checked_alloc(n * sizeof(Process));
+    Histogram *h = checked_alloc(2 * sizeof(Histogram));
+    GanttLog gantt = { NULL, 0, 0, 0, 0 };
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        int j = pool->next_job++;
+        pthread_mutex_unlock(&pool->lock);
+        if (j >= pool->job_count)
+            break;
+        run_compare_job(&pool->jobs[j], pool->input, copy, n, pool->cpus, &gantt, h);
+    }
+
+    free(h);
+    gantt_free(&gantt);
+    free(copy);
+    PROFILE_FLUSH();
+    return NULL;
+}
+
+/* Parses a comma-separated list of algorithm names into a bit mask indexed by Algorithm. */
+int parse_algorithm_list(const char *spec, unsigned *mask) {
+    char name[32];
+    *mask = 0;
+    while (*spec) {
+        size_t len = strcspn(spec, ",");
+        if (len == 0 || len >= sizeof(name))
+            return 0;
+        memcpy(name, spec, len);
+        name[len] = '\0';
+        int algo = algorithm_from_name(name);
+        if (algo < 0)
+            return 0;
+        *mask |= 1u << algo;
+        spec += len;
+        if (*spec == ',')
+            spec++;
+    }
+    return *mask != 0;
+}
+
+/*
+ * Jobs for the algorithms in mask, RR once per quantum. MLFQ and CFS have no
+ * multi-CPU version and model neither switch costs nor I/O, so they are left
+ * out when any of those is in play.
+ */
+static int compare_jobs(unsigned mask, const int quanta[], int quantum_count, int cpus, CompareJob **jobs) {
+    int algo_count = cpus > 1 || overhead_enabled() || trace_bursts.first != NULL ? ALGO_MLFQ : ALGO_COUNT;
+    *jobs = checked_alloc((algo_count + quantum_count) * sizeof(CompareJob));
+    int j = 0;
+    for (int a = 0; a < algo_count; a++) {
+        if (!(mask & (1u << a)))
+            continue;
+        if (a == ALGO_RR) {
+            for (int k = 0; k < quantum_count; k++) {
+                (*jobs)[j].algo = ALGO_RR;
+                (*jobs)[j++].quantum = quanta[k];
+            }
+        } else {
+            (*jobs)[j].algo = a;
+            (*jobs)[j++].quantum = 0;
+        }
+    }
+    return j;
+}
+
+static void compare_label(const CompareJob *job, char *label, size_t size) {
+    if (job->algo == ALGO_RR)
+        snprintf(label, size, "rr (q=%d)", job->quantum);
+    else
+        snprintf(label, size, "%s", algorithm_names[job->algo]);
+}
+
+/* Parses "2,4,8", "1-16" or "1-64:4" into a newly allocated list. */
+int parse_quanta(const char *spec, int **quanta) {
+    int first, last, step = 1, count = 0;
+    char tail;
+    if (sscanf(spec, "%d-%d:%d%c", &first, &last, &step, &tail) == 3 ||
+        sscanf(spec, "%d-%d%c", &first, &last, &tail) == 2) {
+        if (first <= 0 || last < first || step <= 0)
+            return -1;
+        count = (last - first) / step + 1;
+        *quanta = checked_alloc(count * sizeof(int));
+        for (int k = 0; k < count; k++)
+            (*quanta)[k] = first + k * step;
+        return count;
+    }
+
+    for (const char *c = spec; *c; c++)
+        count += *c == ',';
+    count++;
+    *quanta = checked_alloc(count * sizeof(int));
+    const char *c = spec;
+    for (int k = 0; k < count; k++) {
+        char *end;
+        long q = strtol(c, &end, 10);
+        if (end == c || q <= 0 || q > 2147483647L || (*end != ',' && *end != '\0')) {
+            free(*quanta);
+            *quanta = NULL;
+            return -1;
+        }
+        (*quanta)[k] = (int)q;
+        c = end + 1;
+    }
+    return count;
+}
+
+/* Reads the per-level MLFQ quanta, top level first, in any parse_quanta() form. */
+int parse_mlfq_quanta(const char *spec, MlfqConfig *config) {
+    int *quanta = NULL;
+    int count = parse_quanta(spec, &quanta);
+    if (count <= 0 || count > MLFQ_MAX_LEVELS) {
+        free(quanta);
         return 0;
     }
+    config->levels = count;
+    for (int l = 0; l < count; l++)
+        config->quanta[l] = quanta[l];
+    free(quanta);
     return 1;
 }
 
-void input_processes(Process processes[], int n, int algo_choice) {
-    for (int i = 0; i < n; i++) {
-        processes[i].id = i + 1;
-        printf("Process %d\n", i + 1);
-        printf("Arrival Time: "); scanf("%d", &processes[i].arrival);
-        printf("Burst Time: "); scanf("%d", &processes[i].burst);
-        
-        if (algo_choice == 4) {
-            printf("Priority (lower number = higher priority): "); scanf("%d", &processes[i].priority);
-        } else {
-            processes[i].priority = 0; 
+typedef struct {
+    int quantum;
+    double avg_waiting;
+    double avg_tat;
+    long long switches;
+    double cost;
+    int pruned;
+} TunePoint;
+
+typedef struct {
+    Process *input;
+    int n;
+    TunePoint *points;
+    int *order;             /* coarse-to-fine visiting order */
+    int count;
+    int next;
+    double weights[3];      /* avg waiting, avg turnaround, context switches */
+    int prune;
+    double best;
+    pthread_mutex_t lock;
+} TunePool;
+
+static void *tune_worker(void *arg) {
+    TunePool *pool = arg;
+    int n = pool->n;
+    Process *copy = checked_alloc(n * sizeof(Process));
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        int j = pool->next++;
+        double best = pool->best;
+        pthread_mutex_unlock(&pool->lock);
+        if (j >= pool->count)
+            break;
+
+        TunePoint *point = &pool->points[pool->order[j]];
+        SchedPolicy policy = algorithm_policy(ALGO_RR, point->quantum);
+        CostBudget budget = { pool->weights[0] / n, pool->weights[1] / n, pool->weights[2],
+                              pool->prune ? best : DBL_MAX, 0, 0, 0 };
+        reset_processes(copy, pool->input, n);
+        SchedStatus status = simulate_budgeted(copy, n, &policy, NULL, &budget);
+        if (status == SCHED_STOPPED) {
+            point->pruned = 1;
+            continue;
         }
-        processes[i].remaining_bt = processes[i].burst;
+        checked_run(status);
+
+        double total_wt = 0, total_tat = 0;
+        for (int i = 0; i < n; i++) {
+            total_wt += copy[i].waiting;
+            total_tat += copy[i].tat;
+        }
+        point->avg_waiting = total_wt / n;
+        point->avg_tat = total_tat / n;
+        point->switches = budget.switches;
+        point->cost = budget.cost;
+
+        pthread_mutex_lock(&pool->lock);
+        if (point->cost < pool->best)
+            pool->best = point->cost;
+        pthread_mutex_unlock(&pool->lock);
     }
+
+    free(copy);
+    PROFILE_FLUSH();
+    return NULL;
 }
 
-void reset_processes(Process dest[], Process src[], int n) {
-    for (int i = 0; i < n; i++) {
-        dest[i] = src[i];
-        dest[i].remaining_bt = dest[i].burst;
-        dest[i].waiting = 0;
-        dest[i].tat = 0;
-        dest[i].ct = 0; 
+/*
+ * Sweeps the RR quantum over quanta[] and reports the one with the lowest
+ * weighted cost. With pruning, a run stops as soon as its partial cost
+ * exceeds the best finished run, since every term only grows over a run.
+ */
+int tune_quantum(Process processes[], int n, const int quanta[], int count,
+                 const double weights[3], int prune, int threads) {
+    TunePool pool = { processes, n, checked_alloc(count * sizeof(TunePoint)),
+                      checked_alloc(count * sizeof(int)), count, 0,
+                      { weights[0], weights[1], weights[2] }, prune, DBL_MAX,
+                      PTHREAD_MUTEX_INITIALIZER };
+    memset(pool.points, 0, count * sizeof(TunePoint));
+    for (int k = 0; k < count; k++)
+        pool.points[k].quantum = quanta[k];
+
+    /* Visit a coarse grid first so a good bound is known early, then refine. */
+    int step = 1, visited = 0;
+    while (step * 2 < count)
+        step *= 2;
+    for (int k = 0; k < count; k += step)
+        pool.order[visited++] = k;
+    for (; step > 1; step /= 2) {
+        for (int k = step / 2; k < count; k += step)
+            pool.order[visited++] = k;
     }
-}
 
-void print_results(Process processes[], int n, float awt, float atat) {
-    printf("\nID\tArrival\tBurst\tPriority\tCT\tWaiting\tTAT\n");
-    for (int i = 0; i < n; i++) {
-        printf("%d\t%d\t%d\t%d\t\t%d\t%d\t%d\n", 
-               processes[i].id, processes[i].arrival,
-               processes[i].burst, processes[i].priority,
-               processes[i].ct, processes[i].waiting, processes[i].tat);
+    if (threads > count)
+        threads = count;
+    if (threads < 1)
+        threads = 1;
+    pthread_t *workers = checked_alloc(threads * sizeof(pthread_t));
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&workers[t], NULL, tune_worker, &pool) != 0)
+            break;
+        started++;
     }
-    printf("\nAverage Waiting Time: %.2f\n", awt);
-    printf("Average Turnaround Time: %.2f\n", atat);
-}
+    if (started == 0)
+        tune_worker(&pool);
+    for (int t = 0; t < started; t++)
+        pthread_join(workers[t], NULL);
+    free(workers);
 
-void display_gantt_chart(GanttEntry gantt[], int count) {
-    printf("\nGantt Chart:\n");
-    for (int i = 0; i < count; i++) {
-        printf("| P%d (%d-%d) ", gantt[i].process_id, 
-              gantt[i].start_time, gantt[i].end_time);
+    int best = -1;
+    for (int k = 0; k < count; k++) {
+        TunePoint *point = &pool.points[k];
+        if (!point->pruned && (best == -1 || point->cost < pool.points[best].cost))
+            best = k;
     }
-    printf("|\n");
-    
 
-    for (int i = 0; i < count; i++) {
-        printf("\nProcessing P%d [", gantt[i].process_id);
-        int duration = gantt[i].end_time - gantt[i].start_time;
-        for (int j = 0; j < duration; j++) {
-            printf("#");
-            fflush(stdout);
-            sleep(1);
-        }
-        printf("] %d-%d ", gantt[i].start_time, gantt[i].end_time);
+    printf("\n--- Round Robin Quantum Tuning (%d processes, weights waiting=%g tat=%g switches=%g) ---\n",
+           n, weights[0], weights[1], weights[2]);
+    printf("%8s %14s %16s %12s %14s\n", "Quantum", "Avg Waiting", "Avg Turnaround", "Switches", "Objective");
+    for (int k = 0; k < count; k++) {
+        TunePoint *point = &pool.points[k];
+        if (point->pruned)
+            printf("%8d %14s %16s %12s %14s\n", point->quantum, "-", "-", "-", "pruned");
+        else
+            printf("%8d %14.2f %16.2f %12lld %14.4f%s\n", point->quantum, point->avg_waiting,
+                   point->avg_tat, point->switches, point->cost, k == best ? "  <- best" : "");
     }
-    printf("\n");
+    int best_quantum = pool.points[best].quantum;
+    printf("\nBest quantum: %d (objective %.4f)\n", best_quantum, pool.points[best].cost);
+    free(pool.points);
+    free(pool.order);
+    return best_quantum;
 }
 
-void fcfs(Process processes[], int n, float results[], GanttEntry gantt[], int *gantt_index) {
-    Process temp[n];
-    memcpy(temp, processes, sizeof(temp));
-    
-    
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n-1; j++) {
-            if (temp[j].arrival > temp[j+1].arrival) {
-                Process swap = temp[j];
-                temp[j] = temp[j+1];
-                temp[j+1] = swap;
-            }
-        }
+/* "waiting", "tat", "switches" or "mix:W,T,S" for a weighted combination. */
+int parse_objective(const char *spec, double weights[3]) {
+    weights[0] = weights[1] = weights[2] = 0;
+    if (strcmp(spec, "waiting") == 0)
+        weights[0] = 1;
+    else if (strcmp(spec, "tat") == 0)
+        weights[1] = 1;
+    else if (strcmp(spec, "switches") == 0)
+        weights[2] = 1;
+    else if (strncmp(spec, "mix:", 4) == 0) {
+        char tail;
+        if (sscanf(spec + 4, "%lf,%lf,%lf%c", &weights[0], &weights[1], &weights[2], &tail) != 3)
+            return 0;
+        if (weights[0] < 0 || weights[1] < 0 || weights[2] < 0)
+            return 0;
+    } else {
+        return 0;
     }
+    return 1;
+}
 
-    int current_time = 0;
-    float total_wt = 0, total_tat = 0;
-    
-    for (int i = 0; i < n; i++) {
-        if (current_time < temp[i].arrival)
-            current_time = temp[i].arrival;
-        
-        
-        gantt[*gantt_index].process_id = temp[i].id;
-        gantt[*gantt_index].start_time = current_time;
-        gantt[*gantt_index].end_time = current_time + temp[i].burst;
-        (*gantt_index)++;
-            
-        temp[i].waiting = current_time - temp[i].arrival;
-        current_time += temp[i].burst;
-        temp[i].tat = temp[i].waiting + temp[i].burst;
-        temp[i].ct = current_time;  
-        
-        total_wt += temp[i].waiting;
-        total_tat += temp[i].tat;
-    }
-    
-    results[0] = total_wt / n;
-    results[1] = total_tat / n;
-    display_gantt_chart(gantt, *gantt_index);
-    print_results(temp, n, results[0], results[1]);
+int default_thread_count(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
 }
 
-void sjf_non_preemptive(Process processes[], int n, float results[], GanttEntry gantt[], int *gantt_index) {
-    Process temp[n];
-    memcpy(temp, processes, sizeof(temp));
-    int completed = 0, current_time = 0;
-    float total_wt = 0, total_tat = 0;
+/* Runs the algorithms in the mask, RR once per quantum, on a pool of threads. */
+void compare_algorithms(Process processes[], int n, unsigned algorithms, const int quanta[], int quantum_count,
+                        int threads, int cpus) {
+    CompareJob *jobs;
+    int job_count = compare_jobs(algorithms, quanta, quantum_count, cpus, &jobs);
+    int j;
 
-    while (completed < n) {
-        int shortest = -1;
-        int min_burst = 9999;
-        
-        for (int i = 0; i < n; i++) {
-            if (temp[i].arrival <= current_time && 
-               temp[i].remaining_bt > 0 &&
-               temp[i].burst < min_burst) {
-                shortest = i;
-                min_burst = temp[i].burst;
-            }
-        }
-        
-        if (shortest == -1) {
-            current_time++;
-            continue;
-        }
-        
-         
-        gantt[*gantt_index].process_id = temp[shortest].id;
-        gantt[*gantt_index].start_time = current_time;
-        gantt[*gantt_index].end_time = current_time + temp[shortest].burst;
-        (*gantt_index)++;
-        
-        current_time += temp[shortest].burst;
-        temp[shortest].remaining_bt = 0;
-        temp[shortest].tat = current_time - temp[shortest].arrival;
-        temp[shortest].waiting = temp[shortest].tat - temp[shortest].burst;
-        temp[shortest].ct = current_time;  
-        
-        total_wt += temp[shortest].waiting;
-        total_tat += temp[shortest].tat;
-        completed++;
+    ComparePool pool = { processes, n, jobs, job_count, 0, cpus, PTHREAD_MUTEX_INITIALIZER };
+    if (threads > job_count)
+        threads = job_count;
+    if (threads < 1)
+        threads = 1;
+    pthread_t *workers = checked_alloc(threads * sizeof(pthread_t));
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&workers[t], NULL, compare_worker, &pool) != 0)
+            break;
+        started++;
     }
-    
-    results[0] = total_wt / n;
-    results[1] = total_tat / n;
-    display_gantt_chart(gantt, *gantt_index);
-    print_results(temp, n, results[0], results[1]);
+    if (started == 0)
+        compare_worker(&pool);
+    for (int t = 0; t < started; t++)
+        pthread_join(workers[t], NULL);
+    free(workers);
+
+    if (cpus > 1)
+        printf("\n--- Algorithm Comparison (%d processes, %d CPUs, %d threads) ---\n", n, cpus, started ? started : 1);
+    else
+        printf("\n--- Algorithm Comparison (%d processes, %d threads) ---\n", n, started ? started : 1);
+    printf("%-24s %14s %16s %14s %12s %13s\n", "Algorithm", "Avg Waiting", "Avg Turnaround", "Avg Response",
+           "P99 Waiting", "P99 Response");
+    for (j = 0; j < job_count; j++) {
+        char label[48];
+        compare_label(&jobs[j], label, sizeof(label));
+        printf("%-24s %14.2f %16.2f %14.2f %12d %13d\n", label,
+               jobs[j].avg_waiting, jobs[j].avg_tat, jobs[j].avg_response,
+               jobs[j].p99_waiting, jobs[j].p99_response);
+    }
+    free(jobs);
 }
 
-void sjf_preemptive(Process processes[], int n, float results[], GanttEntry gantt[], int *gantt_index) {
-    Process temp[n];
-    memcpy(temp, processes, sizeof(temp));
-    int completed = 0, current_time = 0;
-    float total_wt = 0, total_tat = 0;
-    int current_process = -1;  
-    int first_arrival = 9999; 
+const char *workload_names[WL_COUNT] = { "uniform", "poisson", "pareto", "bursty", "zero" };
 
-     
-    for (int i = 0; i < n; i++) {
-        if (temp[i].arrival < first_arrival) {
-            first_arrival = temp[i].arrival;
-        }
+int workload_from_name(const char *name) {
+    for (int w = 0; w < WL_COUNT; w++) {
+        if (strcmp(name, workload_names[w]) == 0)
+            return w;
     }
+    return -1;
+}
 
-  
-    current_time = first_arrival;
+double rng_uniform(Rng *rng) {
+    return (rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
 
-    while (completed < n) {
-        
-        int new_arrival = 0;
-        for (int i = 0; i < n; i++) {
-            if (temp[i].arrival == current_time) {
-                new_arrival = 1;
+static double rng_exponential(Rng *rng, double mean) {
+    return -mean * log(1.0 - rng_uniform(rng));
+}
+
+static int clamp_time(double t) {
+    return t >= WORKLOAD_TIME_LIMIT ? WORKLOAD_TIME_LIMIT : (int)t;
+}
+
+/*
+ * Fills p[0..n) with a synthetic workload whose bursts average
+ * spec->mean_burst at roughly spec->load utilisation. The same spec and seed
+ * always give the same processes.
+ */
+void generate_workload(Process p[], int n, const WorkloadSpec *spec, unsigned long long seed) {
+    Rng rng = { seed };
+    double mean = spec->mean_burst;
+    double gap = mean / spec->load;
+    double t = 0;
+    int on_left = 0;
+
+    for (int i = 0; i < n; i++) {
+        int burst = 1 + (int)(rng_uniform(&rng) * (2 * mean - 1));
+        switch (spec->kind) {
+            case WL_UNIFORM:
+                t = rng_uniform(&rng) * gap * n;
+                break;
+            case WL_POISSON:
+                t += rng_exponential(&rng, gap);
+                break;
+            case WL_PARETO: {
+                /* alpha = 1.5 keeps the mean at mean_burst with an unbounded variance. */
+                double xm = mean / 3.0;
+                double b = xm / pow(1.0 - rng_uniform(&rng), 1.0 / 1.5);
+                burst = b > WORKLOAD_MAX_BURST ? WORKLOAD_MAX_BURST : (int)b + 1;
+                t += rng_exponential(&rng, gap);
                 break;
             }
+            case WL_BURSTY:
+                /* On-periods of ~32 jobs arriving 8x faster, separated by idle gaps that keep the mean load. */
+                if (on_left == 0) {
+                    on_left = 1 + (int)rng_exponential(&rng, 32);
+                    t += rng_exponential(&rng, gap * on_left * 7 / 8);
+                }
+                on_left--;
+                t += rng_exponential(&rng, gap / 8);
+                break;
+            case WL_ZERO:
+            default:
+                t = 0;
+                break;
         }
+        p[i].id = i + 1;
+        p[i].arrival = clamp_time(t);
+        p[i].burst = burst;
+        p[i].priority = (int)(rng_uniform(&rng) * 10);
+        p[i].remaining_bt = burst;
+        p[i].waiting = p[i].tat = p[i].ct = 0;
+        p[i].rt = -1;
+        p[i].cpu = -1;
+    }
+}
 
-        
-        int shortest = -1;
-        int min_remaining = 9999;
-        for (int i = 0; i < n; i++) {
-            if (temp[i].arrival <= current_time && 
-                temp[i].remaining_bt > 0 && 
-                temp[i].remaining_bt < min_remaining) {
-                shortest = i;
-                min_remaining = temp[i].remaining_bt;
-            } else if (temp[i].arrival <= current_time && 
-                      temp[i].remaining_bt > 0 && 
-                      temp[i].remaining_bt == min_remaining) {
-            
-                if (current_process != -1 && i == current_process) {
-                    shortest = i;
-                } else if (shortest == -1 || temp[i].id < temp[shortest].id) {
-                    shortest = i;
+long peak_rss_kb(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+    return usage.ru_maxrss;
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+/*
+ * Times every algorithm on every workload for n = 10, 100, ... max_n. The
+ * cost of the next size is extrapolated from the growth seen so far; once it
+ * would exceed budget_s that size is reported as skipped instead of run, so
+ * the quadratic algorithms drop out rather than stall the suite.
+ */
+void run_benchmarks(int max_n, unsigned long long seed, int quantum, int reps,
+                    double budget_s, int json, FILE *out) {
+    Process *input = NULL, *copy = NULL;
+    int input_capacity = 0, copy_capacity = 0;
+    GanttLog gantt = { NULL, 0, 0, 0, 0 };
+    int first = 1;
+
+    if (json)
+        fprintf(out, "{\n  \"seed\": %llu,\n  \"quantum\": %d,\n  \"reps\": %d,\n  \"results\": [", seed, quantum, reps);
+    else
+        fprintf(out, "workload,algorithm,n,events,elapsed_ns,ns_per_event,peak_rss_kb,avg_waiting,skipped\n");
+
+    for (int w = 0; w < WL_COUNT; w++) {
+        double last_ns[ALGO_COUNT] = { 0 }, growth[ALGO_COUNT];
+        int skipped_algo[ALGO_COUNT] = { 0 };
+        for (int a = 0; a < ALGO_COUNT; a++)
+            growth[a] = 10;
+        for (long long n = 10; n <= max_n; n *= 10) {
+            input = checked_reserve(input, &input_capacity, (int)n);
+            copy = checked_reserve(copy, &copy_capacity, (int)n);
+            WorkloadSpec spec = { w, WORKLOAD_MEAN_BURST, WORKLOAD_LOAD };
+            generate_workload(input, (int)n, &spec, seed);
+
+            for (int a = 0; a < ALGO_COUNT; a++) {
+                double best_ns = 0;
+                long long events = 0;
+                float results[2] = { 0, 0 };
+                if (last_ns[a] * growth[a] > budget_s * 1e9)
+                    skipped_algo[a] = 1;
+                if (!skipped_algo[a]) {
+                    for (int r = 0; r < reps; r++) {
+                        struct timespec start, end;
+                        reset_processes(copy, input, (int)n);
+                        gantt_reset(&gantt);
+                        clock_gettime(CLOCK_MONOTONIC, &start);
+                        schedule(a, copy, (int)n, results, &gantt, quantum);
+                        clock_gettime(CLOCK_MONOTONIC, &end);
+                        double ns = elapsed_ns(&start, &end);
+                        if (r == 0 || ns < best_ns)
+                            best_ns = ns;
+                    }
+                    /* Arrivals plus scheduling decisions, each of which opens a Gantt segment even if the log merges it. */
+                    events = n + gantt.decisions;
+                    /* Timings under ~10us are too noisy to extrapolate from. */
+                    if (last_ns[a] > 1e4 && best_ns / last_ns[a] > growth[a])
+                        growth[a] = best_ns / last_ns[a];
+                    last_ns[a] = best_ns;
                 }
-            }
-        }
 
-     
-        if (shortest == -1) {
-         
-            if (current_process != -1) {
-                gantt[*gantt_index].end_time = current_time;
-                (*gantt_index)++;
-                current_process = -1;
+                int skipped = skipped_algo[a];
+                double per_event = events ? best_ns / events : 0;
+                if (json) {
+                    fprintf(out, "%s\n    {\"workload\": \"%s\", \"algorithm\": \"%s\", \"n\": %lld, "
+                            "\"events\": %lld, \"elapsed_ns\": %.0f, \"ns_per_event\": %.2f, "
+                            "\"peak_rss_kb\": %ld, \"avg_waiting\": %.2f, \"skipped\": %s}",
+                            first ? "" : ",", workload_names[w], algorithm_names[a], n, events,
+                            best_ns, per_event, peak_rss_kb(), results[0], skipped ? "true" : "false");
+                } else {
+                    fprintf(out, "%s,%s,%lld,%lld,%.0f,%.2f,%ld,%.2f,%d\n", workload_names[w],
+                            algorithm_names[a], n, events, best_ns, per_event, peak_rss_kb(),
+                            results[0], skipped);
+                }
+                fflush(out);
+                first = 0;
             }
-            current_time++;
-            continue;
         }
+    }
+    if (json)
+        fprintf(out, "\n  ]\n}\n");
 
-     
-        if (current_process != shortest || new_arrival) {
-            if (current_process != -1) {
-                gantt[*gantt_index].end_time = current_time;
-                (*gantt_index)++;
-            }
-            gantt[*gantt_index].process_id = temp[shortest].id;
-            gantt[*gantt_index].start_time = current_time;
-            current_process = shortest;
-        }
+    gantt_free(&gantt);
+    free(input);
+    free(copy);
+}
 
-        
-        temp[shortest].remaining_bt--;
-        current_time++;
+/* Writes a generated workload as a trace that --input can read back. */
+void write_workload(const WorkloadSpec *spec, int n, unsigned long long seed, FILE *out) {
+    Process *p = checked_alloc(n * sizeof(Process));
+    generate_workload(p, n, spec, seed);
+    write_trace_csv(p, n, NULL, out);
+    free(p);
+}
 
-         
-        if (temp[shortest].remaining_bt == 0) {
-            temp[shortest].tat = current_time - temp[shortest].arrival;
-            temp[shortest].waiting = temp[shortest].tat - temp[shortest].burst;
-            temp[shortest].ct = current_time; 
-            total_wt += temp[shortest].waiting;
-            total_tat += temp[shortest].tat;
-            completed++;
-            current_process = -1; 
-            gantt[*gantt_index].end_time = current_time;
-            (*gantt_index)++;
+#define MC_METRICS 5    /* avg waiting, avg turnaround, avg response, p99 waiting, p99 response */
+
+typedef struct {
+    const WorkloadSpec *spec;
+    int n;
+    int replicates;
+    unsigned long long seed;
+    const CompareJob *jobs;
+    int job_count;
+    int cpus;
+    double *samples;    /* replicates x job_count x MC_METRICS */
+    int next;
+    pthread_mutex_t lock;
+} MonteCarloPool;
+
+/*
+ * Seed of replicate k: output k of the splitmix64 stream that starts at seed.
+ * Every replicate has its own stream and any worker can jump straight to it,
+ * so the samples do not depend on which thread ran which replicate.
+ */
+static unsigned long long replicate_seed(unsigned long long seed, int k) {
+    Rng rng = { seed + (unsigned long long)k * 0x9E3779B97F4A7C15ULL };
+    return rng_next(&rng);
+}
+
+static void *monte_carlo_worker(void *arg) {
+    MonteCarloPool *pool = arg;
+    int n = pool->n;
+    Process *input = checked_alloc(n * sizeof(Process));
+    Process *copy = checked_alloc(n * sizeof(Process));
+    Histogram *h = checked_alloc(2 * sizeof(Histogram));
+    GanttLog gantt = { NULL, 0, 0, 0, 0 };
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        int k = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (k >= pool->replicates)
+            break;
+
+        generate_workload(input, n, pool->spec, replicate_seed(pool->seed, k));
+        for (int j = 0; j < pool->job_count; j++) {
+            CompareJob job = pool->jobs[j];
+            run_compare_job(&job, input, copy, n, pool->cpus, &gantt, h);
+            double *sample = &pool->samples[((size_t)k * pool->job_count + j) * MC_METRICS];
+            sample[0] = job.avg_waiting;
+            sample[1] = job.avg_tat;
+            sample[2] = job.avg_response;
+            sample[3] = job.p99_waiting;
+            sample[4] = job.p99_response;
         }
     }
 
-    results[0] = total_wt / n;
-    results[1] = total_tat / n;
-    display_gantt_chart(gantt, *gantt_index);
-    print_results(temp, n, results[0], results[1]);
+    free(h);
+    gantt_free(&gantt);
+    free(copy);
+    free(input);
+    PROFILE_FLUSH();
+    return NULL;
 }
 
-void rr(Process processes[], int n, float results[], GanttEntry gantt[], int *gantt_index, int quantum) {
-    Process temp[n];
-    memcpy(temp, processes, sizeof(temp));
-    int completed = 0, current_time = 0;
-    int ready_queue[1000], front = 0, rear = -1; 
-    float total_wt = 0, total_tat = 0;
-    int current_process = -1;
+/* Two-sided 95% quantile of Student's t distribution with df degrees of freedom. */
+static double t95(int df) {
+    static const double table[30] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (df <= 30)
+        return table[df - 1];
+    return 1.96 + 2.4 / df;
+}
 
- 
-    int first_arrival = 9999;
-    for (int i = 0; i < n; i++) {
-        if (temp[i].arrival < first_arrival) {
-            first_arrival = temp[i].arrival;
-        }
+/*
+ * Simulates the selected algorithms on replicates workloads drawn from spec,
+ * one replicate per task on a pool of threads, and prints the mean of each
+ * metric across workloads with a 95% confidence interval. The samples are
+ * summed in replicate order after the pool finishes, so the output is the
+ * same bit for bit whatever the thread count.
+ */
+int run_monte_carlo(const WorkloadSpec *spec, int n, int replicates, unsigned long long seed, unsigned algorithms,
+                    const int quanta[], int quantum_count, int threads, int cpus) {
+    CompareJob *jobs;
+    int job_count = compare_jobs(algorithms, quanta, quantum_count, cpus, &jobs);
+    if (job_count == 0) {
+        fprintf(stderr, "None of the selected algorithms can run with these options.\n");
+        free(jobs);
+        return 2;
     }
-    current_time = first_arrival;
 
-     
-    for (int i = 0; i < n; i++) {
-        if (temp[i].arrival <= current_time && temp[i].remaining_bt > 0) {
-            ready_queue[++rear] = i;
-        }
+    MonteCarloPool pool = { spec, n, replicates, seed, jobs, job_count, cpus, NULL, 0, PTHREAD_MUTEX_INITIALIZER };
+    pool.samples = checked_alloc((size_t)replicates * job_count * MC_METRICS * sizeof(double));
+    if (threads > replicates)
+        threads = replicates;
+    if (threads < 1)
+        threads = 1;
+    pthread_t *workers = checked_alloc(threads * sizeof(pthread_t));
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&workers[t], NULL, monte_carlo_worker, &pool) != 0)
+            break;
+        started++;
     }
+    if (started == 0)
+        monte_carlo_worker(&pool);
+    for (int t = 0; t < started; t++)
+        pthread_join(workers[t], NULL);
+    free(workers);
 
-    printf("\nRound Robin Scheduling with Time Quantum: %d\n", quantum);
-    while (completed < n) { 
-        if (front > rear) { 
-            if (current_process != -1) {
-                gantt[*gantt_index].end_time = current_time;
-                (*gantt_index)++;
-                current_process = -1;
-            }
-            current_time++; 
-            for (int i = 0; i < n; i++) {
-                if (temp[i].arrival == current_time && temp[i].remaining_bt > 0) {
-                    ready_queue[++rear] = i;
-                }
-            }
-            continue;
-        }
- 
-        int idx = ready_queue[front++];
- 
-        if (current_process != idx) {
-            if (current_process != -1) {
-                gantt[*gantt_index].end_time = current_time;
-                (*gantt_index)++;
-            }
-            gantt[*gantt_index].process_id = temp[idx].id;
-            gantt[*gantt_index].start_time = current_time;
-            current_process = idx;
-        }
- 
-        int exec_time = (temp[idx].remaining_bt > quantum) ? quantum : temp[idx].remaining_bt;
-        for (int t = 0; t < exec_time; t++) {
-            temp[idx].remaining_bt--;
-            current_time++;
- 
-            for (int i = 0; i < n; i++) {
-                if (temp[i].arrival == current_time && temp[i].remaining_bt > 0) {
-                    ready_queue[++rear] = i;
-                }
-            }
-  
-            if (temp[idx].remaining_bt == 0) {
-                temp[idx].tat = current_time - temp[idx].arrival;
-                temp[idx].waiting = temp[idx].tat - temp[idx].burst;
-                temp[idx].ct = current_time; // Completion time
-                total_wt += temp[idx].waiting;
-                total_tat += temp[idx].tat;
-                completed++; 
-                gantt[*gantt_index].end_time = current_time;
-                (*gantt_index)++;
-                current_process = -1;
-                break;  
-            }
-        }
- 
-        if (temp[idx].remaining_bt > 0) {
-            ready_queue[++rear] = idx;
-         
-            if (current_process != -1) {
-                gantt[*gantt_index].end_time = current_time;
-                (*gantt_index)++;
-                current_process = -1;
+    printf("\n--- Monte Carlo: %d %s workloads of %d processes (mean burst %.2f, load %.2f, seed %llu",
+           replicates, workload_names[spec->kind], n, spec->mean_burst, spec->load, seed);
+    if (cpus > 1)
+        printf(", %d CPUs", cpus);
+    printf(") ---\n");
+    printf("Mean across workloads +/- half-width of the 95%% confidence interval\n");
+    printf("%-20s %23s %23s %23s %23s %23s\n", "Algorithm", "Avg Waiting", "Avg Turnaround", "Avg Response",
+           "P99 Waiting", "P99 Response");
+    double t = t95(replicates - 1);
+    for (int j = 0; j < job_count; j++) {
+        char label[48];
+        compare_label(&jobs[j], label, sizeof(label));
+        printf("%-20s", label);
+        for (int m = 0; m < MC_METRICS; m++) {
+            double sum = 0, squares = 0;
+            for (int k = 0; k < replicates; k++)
+                sum += pool.samples[((size_t)k * job_count + j) * MC_METRICS + m];
+            double mean = sum / replicates;
+            for (int k = 0; k < replicates; k++) {
+                double d = pool.samples[((size_t)k * job_count + j) * MC_METRICS + m] - mean;
+                squares += d * d;
             }
+            printf(" %11.2f +/- %7.2f", mean, t * sqrt(squares / (replicates - 1)) / sqrt(replicates));
         }
+        printf("\n");
     }
+    free(pool.samples);
+    free(jobs);
+    return 0;
+}
 
-    results[0] = total_wt / n;
-    results[1] = total_tat / n;
-    display_gantt_chart(gantt, *gantt_index);
-    print_results(temp, n, results[0], results[1]);
+void print_usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("Without options the interactive menu is started.\n\n");
+    printf("  -i, --input FILE       read the process trace from FILE ('-' for stdin, default); a burst of\n");
+    printf("                         5/3@1/4 runs 5 on the CPU, does 3 of I/O on device 1, then runs 4 more\n");
+    printf("  -a, --algorithm NAME   fcfs, sjf, srtf, rr, priority, priority-preemptive, mlfq or cfs (default fcfs),\n");
+    printf("                         or edf and rm with --tasks\n");
+    printf("  -q, --quantum N        time quantum for rr (default 2)\n");
+    printf("      --tasks FILE       simulate a real-time task set with -a edf or rm; lines hold id, period, WCET\n");
+    printf("                         and optional deadline (default period), phase and jitter (sporadic tasks)\n");
+    printf("      --horizon T        release --tasks jobs before time T (default: largest phase plus hyperperiod)\n");
+    printf("      --stream           replay the trace online with bounded memory, reading processes as they arrive\n");
+    printf("      --report N         with --stream, print running metrics every N completed processes (default 0 = none)\n");
+    printf("      --mlfq-quanta LIST quantum per mlfq level, top level first (default 2,4,8)\n");
+    printf("      --mlfq-boost N     move every mlfq process back to the top level every N time units, 0 = never (default 100)\n");
+    printf("      --aging N          priority and priority-preemptive gain one level per N time units waited (default 0 = off)\n");
+    printf("      --switch-cost N    time units charged when a CPU switches from one process to another (default 0)\n");
+    printf("      --dispatch-cost N  time units charged on every dispatch, including resuming the same process (default 0)\n");
+    printf("      --warmup-cost N    time units charged when a process runs on a CPU that last ran something else (default 0)\n");
+    printf("      --convert FILE     write the input trace to FILE and exit, binary unless FILE ends in .csv;\n");
+    printf("                         binary Gantt logs convert to CSV\n");
+    printf("      --gantt-out FILE   write the Gantt log of a single run to FILE: CSV for .csv, Chrome trace-event\n");
+    printf("                         JSON for .json, binary otherwise\n");
+    printf("      --results-out FILE write per-process results of a single or --stream run, JSON for .json, else CSV\n");
+    printf("      --at T             after a single run, print which process held each CPU at time T\n");
+    printf("      --busy A,B         after a single run, print how busy each CPU was over [A, B)\n");
+    printf("      --checkpoint-out FILE\n");
+    printf("                         save checkpoints of a single-CPU run of fcfs, sjf, srtf, rr or priority\n");
+    printf("      --checkpoint-every N time units between checkpoints (default 1000, or as in the --resume file)\n");
+    printf("      --resume FILE      rerun an edited trace from the last checkpoint in FILE before its first change\n");
+    printf("  -P, --cpus N           CPUs for single runs and --compare, with per-CPU queues and work stealing (default 1)\n");
+    printf("  -c, --chart MODE       none, static or animate (default static, animate with --menu)\n");
+    printf("  -d, --delay MS         animation delay per time unit (default 200)\n");
+    printf("  -m, --menu             start the interactive menu with the chart options above\n");
+    printf("      --compare          run every algorithm in parallel and print one comparison table\n");
+    printf("      --quanta LIST      rr quanta for --compare/--tune: 2,4,8, 1-16 or 1-64:4 (default 1,2,4,8,16)\n");
+    printf("      --tune             sweep the rr quantum over --quanta and report the best one\n");
+    printf("      --objective OBJ    waiting, tat, switches or mix:W,T,S weights for --tune (default waiting)\n");
+    printf("      --no-prune         finish every --tune run so the whole curve is printed\n");
+    printf("      --bench            time every algorithm on generated workloads, n = 10 .. --bench-max-n\n");
+    printf("      --bench-max-n N    largest benchmark size (default 1000000)\n");
+    printf("      --bench-reps N     repetitions per run, fastest one is reported (default 1)\n");
+    printf("      --bench-budget S   skip larger sizes once one run takes more than S seconds (default 10)\n");
+    printf("      --format FMT       json or csv benchmark output (default json)\n");
+    printf("      --generate KIND    write a uniform, poisson, pareto, bursty or zero workload trace\n");
+    printf("  -n, --count N          processes for --generate and --monte-carlo (default 1000)\n");
+    printf("      --seed S           seed for --bench, --generate, --monte-carlo and sporadic --tasks (default 1)\n");
+    printf("      --mean-burst B     mean burst of generated workloads (default 10)\n");
+    printf("      --load L           offered CPU load of generated workloads, 0.9 = 90%% busy (default 0.9)\n");
+    printf("      --monte-carlo K    simulate K generated workloads and report means with 95%% confidence intervals\n");
+    printf("      --workload KIND    distribution for --monte-carlo, one of the --generate kinds (default poisson)\n");
+    printf("      --algorithms LIST  comma-separated algorithms for --compare and --monte-carlo (default all)\n");
+    printf("  -j, --threads N        worker threads for --compare, --tune and --monte-carlo (default: online CPUs)\n");
+    printf("  -h, --help             show this help\n\n");
+    printf("Trace lines hold id, arrival, burst, an optional priority and an optional CPU\n");
+    printf("to pin the process to (-1 = any), separated by commas or whitespace. Blank\n");
+    printf("lines, '#' comments and a header row are ignored. Binary traces written by\n");
+    printf("--convert are recognised by their header and used without parsing.\n");
 }
 
-void priority_non_preemptive(Process processes[], int n, float results[], GanttEntry gantt[], int *gantt_index) {
-    int scheduled = 0;
-    int is_completed[n];
-    for (int i = 0; i < n; i++) {
-        is_completed[i] = 0;
+/*
+ * Fills resume with the latest checkpoint in cf before the first process p
+ * differs in, or a NULL point if there is none. Returns 0 if cf was taken
+ * under a different policy.
+ */
+static int prepare_resume(const CheckpointFile *cf, Algorithm algo, const SchedPolicy *policy,
+                          const Process p[], int n, ResumePoint *resume) {
+    CheckpointSettings wanted = checkpoint_settings(algo, policy, 0);
+    const CheckpointSettings *s = &cf->settings;
+    if (s->algo != wanted.algo || s->quantum != wanted.quantum || s->aging != wanted.aging ||
+        s->context_switch != wanted.context_switch || s->dispatch != wanted.dispatch ||
+        s->cache_warmup != wanted.cache_warmup) {
+        fprintf(stderr, "The checkpoints were taken with %s, quantum %d, aging %d and switch costs %d/%d/%d; "
+                "rerun with the same settings.\n", algorithm_names[s->algo >= 0 && s->algo < ALGO_MLFQ ? s->algo : 0],
+                s->quantum, s->aging, s->context_switch, s->dispatch, s->cache_warmup);
+        return 0;
     }
+    resume->changed_at = first_change(cf->base, s->process_count, p, n);
+    resume->point = checkpoint_before(cf, resume->changed_at);
+    resume->records = cf->records;
+    resume->base = cf->base;
+    resume->gantt = cf->gantt;
+    if (resume->point == NULL)
+        fprintf(stderr, "No checkpoint precedes the first change at time %d; simulating from the start.\n",
+                resume->changed_at);
+    return 1;
+}
 
-    int current_time = 0;
-    float total_wt = 0, total_tat = 0;
+int run_batch(int argc, char *argv[]) {
+    const char *input = NULL;
+    int algo = ALGO_FCFS, quantum = 2, cpus = 1, menu = 0, compare = 0, tune = 0, prune = 1;
+    const char *objective = "waiting";
+    int stream = 0;
+    long long report_every = 0;
+    const char *convert_out = NULL, *gantt_out = NULL, *results_out = NULL;
+    int at_time = -1, busy_from = -1, busy_to = -1;
+    const char *checkpoint_out = NULL, *resume_path = NULL;
+    int checkpoint_every = 0;
+    const char *tasks_path = NULL;
+    int rt_policy = -1, horizon = 0;
+    int bench = 0, bench_max_n = 1000000, bench_reps = 1, bench_json = 1, generate = -1, count = 1000;
+    WorkloadSpec workload = { WL_POISSON, WORKLOAD_MEAN_BURST, WORKLOAD_LOAD };
+    int replicates = 0;
+    unsigned algorithms = (1u << ALGO_COUNT) - 1;
+    double bench_budget = 10;
+    unsigned long long seed = 1;
+    int threads = default_thread_count();
+    const char *quanta_spec = "1,2,4,8,16";
+    ChartOptions chart = { CHART_STATIC, 200 };
+    int chart_given = 0;
 
-    
-    while (scheduled < n) {
-        int idx = -1;
-        int highest_priority = 1000000;  
- 
-        for (int i = 0; i < n; i++) {
-            if (!is_completed[i] && processes[i].arrival <= current_time) {
-                if (processes[i].priority < highest_priority) {
-                    highest_priority = processes[i].priority;
-                    idx = i;
-                }
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if ((strcmp(arg, "-i") == 0 || strcmp(arg, "--input") == 0) && value) {
+            input = value;
+            i++;
+        } else if ((strcmp(arg, "-a") == 0 || strcmp(arg, "--algorithm") == 0) && value) {
+            algo = algorithm_from_name(value);
+            rt_policy = rt_policy_from_name(value);
+            if (algo < 0 && rt_policy < 0) {
+                fprintf(stderr, "Unknown algorithm: %s\n", value);
+                return 2;
             }
-        }
- 
-        if (idx == -1) {
-            int min_arrival = 1000000;
-            for (int i = 0; i < n; i++) {
-                if (!is_completed[i] && processes[i].arrival < min_arrival) {
-                    min_arrival = processes[i].arrival;
-                    idx = i;
-                }
+            if (algo < 0)
+                algo = ALGO_FCFS;
+            i++;
+        } else if (strcmp(arg, "--tasks") == 0 && value) {
+            tasks_path = value;
+            i++;
+        } else if (strcmp(arg, "--horizon") == 0 && value) {
+            horizon = atoi(value);
+            if (horizon <= 0) {
+                fprintf(stderr, "Invalid horizon: %s\n", value);
+                return 2;
+            }
+            i++;
+        } else if ((strcmp(arg, "-q") == 0 || strcmp(arg, "--quantum") == 0) && value) {
+            quantum = atoi(value);
+            i++;
+        } else if ((strcmp(arg, "-P") == 0 || strcmp(arg, "--cpus") == 0) && value) {
+            cpus = atoi(value);
+            if (cpus <= 0) {
+                fprintf(stderr, "Invalid CPU count: %s\n", value);
+                return 2;
+            }
+            i++;
+        } else if ((strcmp(arg, "-c") == 0 || strcmp(arg, "--chart") == 0) && value) {
+            int mode = parse_chart_mode(value);
+            if (mode < 0) {
+                fprintf(stderr, "Unknown chart mode: %s\n", value);
+                return 2;
             }
-            current_time = processes[idx].arrival;
+            chart.mode = mode;
+            chart_given = 1;
+            i++;
+        } else if ((strcmp(arg, "-d") == 0 || strcmp(arg, "--delay") == 0) && value) {
+            chart.delay_ms = atoi(value);
+            if (chart.delay_ms < 0)
+                chart.delay_ms = 0;
+            i++;
+        } else if (strcmp(arg, "-m") == 0 || strcmp(arg, "--menu") == 0) {
+            menu = 1;
+        } else if (strcmp(arg, "--mlfq-quanta") == 0 && value) {
+            if (!parse_mlfq_quanta(value, &mlfq_config)) {
+                fprintf(stderr, "Invalid MLFQ quanta (1 to %d levels): %s\n", MLFQ_MAX_LEVELS, value);
+                return 2;
+            }
+            i++;
+        } else if (strcmp(arg, "--mlfq-boost") == 0 && value) {
+            mlfq_config.boost_period = atoi(value) > 0 ? atoi(value) : 0;
+            i++;
+        } else if (strcmp(arg, "--aging") == 0 && value) {
+            priority_aging = atoi(value) > 0 ? atoi(value) : 0;
+            i++;
+        } else if (strcmp(arg, "--switch-cost") == 0 && value) {
+            overhead_model.context_switch = atoi(value) > 0 ? atoi(value) : 0;
+            i++;
+        } else if (strcmp(arg, "--dispatch-cost") == 0 && value) {
+            overhead_model.dispatch = atoi(value) > 0 ? atoi(value) : 0;
+            i++;
+        } else if (strcmp(arg, "--warmup-cost") == 0 && value) {
+            overhead_model.cache_warmup = atoi(value) > 0 ? atoi(value) : 0;
+            i++;
+        } else if (strcmp(arg, "--convert") == 0 && value) {
+            convert_out = value;
+            i++;
+        } else if (strcmp(arg, "--gantt-out") == 0 && value) {
+            gantt_out = value;
+            i++;
+        } else if (strcmp(arg, "--results-out") == 0 && value) {
+            results_out = value;
+            i++;
+        } else if (strcmp(arg, "--at") == 0 && value) {
+            at_time = atoi(value);
+            if (at_time < 0) {
+                fprintf(stderr, "Invalid time: %s\n", value);
+                return 2;
+            }
+            i++;
+        } else if (strcmp(arg, "--busy") == 0 && value) {
+            if (sscanf(value, "%d,%d", &busy_from, &busy_to) != 2 || busy_from < 0 || busy_to <= busy_from) {
+                fprintf(stderr, "Invalid interval (A,B with 0 <= A < B): %s\n", value);
+                return 2;
+            }
+            i++;
+        } else if (strcmp(arg, "--checkpoint-out") == 0 && value) {
+            checkpoint_out = value;
+            i++;
+        } else if (strcmp(arg, "--checkpoint-every") == 0 && value) {
+            checkpoint_every = atoi(value);
+            if (checkpoint_every <= 0) {
+                fprintf(stderr, "Invalid checkpoint interval: %s\n", value);
+                return 2;
+            }
+            i++;
+        } else if (strcmp(arg, "--resume") == 0 && value) {
+            resume_path = value;
+            i++;
+        } else if (strcmp(arg, "--stream") == 0) {
+            stream = 1;
+        } else if (strcmp(arg, "--report") == 0 && value) {
+            report_every = atoll(value);
+            i++;
+        } else if (strcmp(arg, "--compare") == 0) {
+            compare = 1;
+        } else if (strcmp(arg, "--tune") == 0) {
+            tune = 1;
+        } else if (strcmp(arg, "--objective") == 0 && value) {
+            objective = value;
+            i++;
+        } else if (strcmp(arg, "--no-prune") == 0) {
+            prune = 0;
+        } else if (strcmp(arg, "--bench") == 0) {
+            bench = 1;
+        } else if (strcmp(arg, "--bench-max-n") == 0 && value) {
+            bench_max_n = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--bench-reps") == 0 && value) {
+            bench_reps = atoi(value) > 0 ? atoi(value) : 1;
+            i++;
+        } else if (strcmp(arg, "--bench-budget") == 0 && value) {
+            bench_budget = atof(value);
+            i++;
+        } else if (strcmp(arg, "--format") == 0 && value) {
+            if (strcmp(value, "json") != 0 && strcmp(value, "csv") != 0) {
+                fprintf(stderr, "Unknown format: %s\n", value);
+                return 2;
+            }
+            bench_json = strcmp(value, "json") == 0;
+            i++;
+        } else if (strcmp(arg, "--seed") == 0 && value) {
+            seed = strtoull(value, NULL, 10);
+            i++;
+        } else if (strcmp(arg, "--generate") == 0 && value) {
+            generate = workload_from_name(value);
+            if (generate < 0) {
+                fprintf(stderr, "Unknown workload: %s\n", value);
+                return 2;
+            }
+            i++;
+        } else if ((strcmp(arg, "-n") == 0 || strcmp(arg, "--count") == 0) && value) {
+            count = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--mean-burst") == 0 && value) {
+            workload.mean_burst = atof(value);
+            i++;
+        } else if (strcmp(arg, "--load") == 0 && value) {
+            workload.load = atof(value);
+            i++;
+        } else if (strcmp(arg, "--monte-carlo") == 0 && value) {
+            replicates = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--workload") == 0 && value) {
+            workload.kind = workload_from_name(value);
+            if ((int)workload.kind < 0) {
+                fprintf(stderr, "Unknown workload: %s\n", value);
+                return 2;
+            }
+            i++;
+        } else if (strcmp(arg, "--algorithms") == 0 && value) {
+            if (!parse_algorithm_list(value, &algorithms)) {
+                fprintf(stderr, "Invalid algorithm list: %s\n", value);
+                return 2;
+            }
+            i++;
+        } else if (strcmp(arg, "--quanta") == 0 && value) {
+            quanta_spec = value;
+            i++;
+        } else if ((strcmp(arg, "-j") == 0 || strcmp(arg, "--threads") == 0) && value) {
+            threads = atoi(value);
+            i++;
+        } else {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            print_usage(argv[0]);
+            return 2;
         }
- 
-        gantt[*gantt_index].process_id = processes[idx].id;
-        gantt[*gantt_index].start_time = current_time;
-        gantt[*gantt_index].end_time = current_time + processes[idx].burst;
-        (*gantt_index)++;
- 
-        processes[idx].waiting = current_time - processes[idx].arrival;
-        current_time += processes[idx].burst;
-        processes[idx].tat = processes[idx].waiting + processes[idx].burst;
-        processes[idx].ct = current_time;
-
-        total_wt += processes[idx].waiting;
-        total_tat += processes[idx].tat;
-        is_completed[idx] = 1;
-        scheduled++;
     }
 
-    results[0] = total_wt / n;
-    results[1] = total_tat / n;
-    display_gantt_chart(gantt, *gantt_index);
-    print_results(processes, n, results[0], results[1]);
-}
-
-
-void priority_preemptive(Process processes[], int n, float results[], GanttEntry gantt[], int *gantt_index) {
-    Process temp[n];
-    memcpy(temp, processes, sizeof(temp)); 
-
-    int completed = 0, current_time = 0;
-    float total_wt = 0, total_tat = 0;
-    int current_process = -1;
-    int first_arrival = 9999;
- 
-    for (int i = 0; i < n; i++) {
-        if (temp[i].arrival < first_arrival) {
-            first_arrival = temp[i].arrival;
+    if (menu) {
+        if (!chart_given)
+            chart.mode = CHART_ANIMATED;
+        return run_interactive(&chart);
+    }
+    if (bench) {
+        run_benchmarks(bench_max_n, seed, quantum, bench_reps, bench_budget, bench_json, stdout);
+        return 0;
+    }
+    if (generate >= 0 || replicates != 0) {
+        if (count <= 0) {
+            fprintf(stderr, "Invalid process count: %d\n", count);
+            return 2;
+        }
+        if (!(workload.mean_burst >= 1 && workload.mean_burst <= WORKLOAD_MAX_BURST) || !(workload.load > 0)) {
+            fprintf(stderr, "Generated workloads need a mean burst from 1 to %d and a positive load.\n",
+                    WORKLOAD_MAX_BURST);
+            return 2;
+        }
+    }
+    if (generate >= 0) {
+        workload.kind = generate;
+        write_workload(&workload, count, seed, stdout);
+        return 0;
+    }
+    if (replicates != 0) {
+        int *quanta = NULL;
+        if (replicates < 2) {
+            fprintf(stderr, "--monte-carlo needs at least 2 workloads for a confidence interval.\n");
+            return 2;
+        }
+        int quantum_count = parse_quanta(quanta_spec, &quanta);
+        if (quantum_count <= 0) {
+            fprintf(stderr, "Invalid quantum list: %s\n", quanta_spec);
+            return 2;
         }
+        int status = run_monte_carlo(&workload, count, replicates, seed, algorithms, quanta, quantum_count,
+                                     threads, cpus);
+        free(quanta);
+        return status;
+    }
+    if (convert_out != NULL)
+        return convert_file(input, convert_out);
+    if ((tasks_path != NULL) != (rt_policy >= 0)) {
+        fprintf(stderr, "Real-time task sets run with -a edf or -a rm and --tasks FILE, both together.\n");
+        return 2;
+    }
+    if (tasks_path != NULL) {
+        if (stream || compare || tune || cpus > 1)
+            fprintf(stderr, "--tasks simulates one CPU; ignoring --stream, --cpus, --compare and --tune.\n");
+        return run_realtime(tasks_path, rt_policy, horizon, seed, &chart, gantt_out);
+    }
+    if (gantt_out != NULL && (stream || compare || tune)) {
+        fprintf(stderr, "--gantt-out only applies to single runs; ignoring it.\n");
+        gantt_out = NULL;
+    }
+    if (results_out != NULL && !stream && (compare || tune)) {
+        fprintf(stderr, "--results-out only applies to single and --stream runs; ignoring it.\n");
+        results_out = NULL;
+    }
+    if ((at_time >= 0 || busy_from >= 0) && (stream || compare || tune)) {
+        fprintf(stderr, "--at and --busy only apply to single runs; ignoring them.\n");
+        at_time = busy_from = -1;
+    }
+    if ((checkpoint_out != NULL || resume_path != NULL) && (stream || compare || tune)) {
+        fprintf(stderr, "--checkpoint-out and --resume only apply to single runs; ignoring them.\n");
+        checkpoint_out = resume_path = NULL;
+    }
+    if ((checkpoint_out != NULL || resume_path != NULL) && (cpus > 1 || algo >= ALGO_MLFQ)) {
+        fprintf(stderr, "Checkpoints cover single-CPU runs of fcfs, sjf, srtf, rr and the priority algorithms.\n");
+        return 2;
     }
-    current_time = first_arrival;
 
-    while (completed < n) {
-        int new_arrival = 0;
-        for (int i = 0; i < n; i++) {
-            if (temp[i].arrival == current_time) {
-                new_arrival = 1;
-                break;
-            }
+    if ((stream || cpus > 1) && algo >= ALGO_MLFQ && !compare && !tune) {
+        fprintf(stderr, "%s is not available with --stream or --cpus.\n", algorithm_names[algo]);
+        return 2;
+    }
+    if (overhead_enabled() && algo >= ALGO_MLFQ && !compare && !tune) {
+        fprintf(stderr, "%s does not model switch costs; drop --switch-cost, --dispatch-cost and --warmup-cost.\n",
+                algorithm_names[algo]);
+        return 2;
+    }
+    if (stream) {
+        if (quantum <= 0) {
+            printf("Invalid input: Time quantum must be positive for Round Robin.\n");
+            return 1;
         }
- 
-        int highest_priority = -1;
-        int min_priority = 9999;
-        for (int i = 0; i < n; i++) {
-            if (temp[i].arrival <= current_time && temp[i].remaining_bt > 0 && 
-                temp[i].priority < min_priority) {
-                highest_priority = i;
-                min_priority = temp[i].priority;
-            } else if (temp[i].arrival <= current_time && temp[i].remaining_bt > 0 && 
-                      temp[i].priority == min_priority) {
-                if (current_process != -1 && i == current_process) {
-                    highest_priority = i;
-                } else if (highest_priority == -1 || temp[i].id < temp[highest_priority].id) {
-                    highest_priority = i;
-                }
-            }
+        if (cpus > 1 || compare || tune)
+            fprintf(stderr, "--stream simulates a single CPU; ignoring --cpus, --compare and --tune.\n");
+        return run_stream(input, algo, quantum, report_every, results_out);
+    }
+
+    Process *processes = NULL;
+    int capacity = 0;
+    InputFile file;
+    int n = load_trace(input, &processes, &capacity, &file, &trace_bursts);
+    if (n < 0) {
+        release_trace(processes, &file, &trace_bursts);
+        return 1;
+    }
+    if (n == 0) {
+        fprintf(stderr, "The trace contains no processes.\n");
+        release_trace(processes, &file, &trace_bursts);
+        return 1;
+    }
+    if (!validate_inputs(processes, n, quantum)) {
+        release_trace(processes, &file, &trace_bursts);
+        return 1;
+    }
+    if (trace_bursts.first != NULL && (cpus > 1 || (algo >= ALGO_MLFQ && !compare && !tune))) {
+        if (cpus > 1)
+            fprintf(stderr, "I/O bursts are simulated on a single CPU; drop --cpus.\n");
+        else
+            fprintf(stderr, "%s does not model I/O bursts.\n", algorithm_names[algo]);
+        release_trace(processes, &file, &trace_bursts);
+        return 2;
+    }
+    for (int i = 0; i < n && cpus > 1; i++) {
+        if (processes[i].cpu >= cpus) {
+            fprintf(stderr, "Process %d is pinned to CPU %d, but only %d CPUs are simulated.\n",
+                    processes[i].id, processes[i].cpu, cpus);
+            release_trace(processes, &file, &trace_bursts);
+            return 1;
         }
+    }
 
-        if (highest_priority == -1) {
-            if (current_process != -1) {
-                gantt[*gantt_index].end_time = current_time;
-                (*gantt_index)++;
-                current_process = -1;
-            }
-            current_time++;
-            continue;
+    if (compare || tune) {
+        int *quanta = NULL;
+        double weights[3];
+        int quantum_count = parse_quanta(quanta_spec, &quanta);
+        if (quantum_count <= 0) {
+            fprintf(stderr, "Invalid quantum list: %s\n", quanta_spec);
+            release_trace(processes, &file, &trace_bursts);
+            return 2;
         }
- 
-        if (current_process != highest_priority || new_arrival) {
-            if (current_process != -1) {
-                gantt[*gantt_index].end_time = current_time;
-                (*gantt_index)++;
-            }
-            gantt[*gantt_index].process_id = temp[highest_priority].id;
-            gantt[*gantt_index].start_time = current_time;
-            current_process = highest_priority;
+        if (tune && !parse_objective(objective, weights)) {
+            fprintf(stderr, "Invalid objective: %s\n", objective);
+            free(quanta);
+            release_trace(processes, &file, &trace_bursts);
+            return 2;
         }
- 
-        temp[highest_priority].remaining_bt--;
-        current_time++;
- 
-        if (temp[highest_priority].remaining_bt == 0) {
-            temp[highest_priority].tat = current_time - temp[highest_priority].arrival;
-            temp[highest_priority].waiting = temp[highest_priority].tat - temp[highest_priority].burst;
-            temp[highest_priority].ct = current_time;
-            total_wt += temp[highest_priority].waiting;
-            total_tat += temp[highest_priority].tat;
-            completed++;
-            current_process = -1;
-            gantt[*gantt_index].end_time = current_time;
-            (*gantt_index)++;
+        /* Round Robin at the smallest quantum dispatches the most, so it bounds every run. */
+        int smallest = quanta[0];
+        for (int q = 1; q < quantum_count; q++)
+            smallest = quanta[q] < smallest ? quanta[q] : smallest;
+        if (!validate_horizon(processes, n, ALGO_RR, smallest)) {
+            free(quanta);
+            release_trace(processes, &file, &trace_bursts);
+            return 1;
         }
+        if (compare)
+            compare_algorithms(processes, n, algorithms, quanta, quantum_count, threads, cpus);
+        if (tune)
+            tune_quantum(processes, n, quanta, quantum_count, weights, prune, threads);
+        free(quanta);
+        release_trace(processes, &file, &trace_bursts);
+        return 0;
     }
 
-  
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            if (processes[i].id == temp[j].id) {
-                processes[i].ct = temp[j].ct;
-                processes[i].waiting = temp[j].waiting;
-                processes[i].tat = temp[j].tat;
-                break;
-            }
+    if (!validate_horizon(processes, n, algo, quantum)) {
+        release_trace(processes, &file, &trace_bursts);
+        return 1;
+    }
+    SchedPolicy policy = algorithm_policy(algo, quantum);
+    CheckpointFile checkpoints;
+    CheckpointLog log;
+    ResumePoint resume;
+    memset(&checkpoints, 0, sizeof(checkpoints));
+    memset(&log, 0, sizeof(log));
+    if (trace_bursts.first != NULL && (checkpoint_out != NULL || resume_path != NULL)) {
+        fprintf(stderr, "Checkpoints do not cover I/O bursts.\n");
+        release_trace(processes, &file, &trace_bursts);
+        return 2;
+    }
+    /*
+     * fcfs lists the table in arrival order. Sorting it before the run, rather
+     * than after, keeps the checkpoints' process indices in that order too,
+     * so an edited trace is compared with the saved one row by row.
+     */
+    if (algo == ALGO_FCFS && cpus == 1 && (checkpoint_out != NULL || resume_path != NULL))
+        checked_run(sort_by_arrival(processes, n));
+    if (resume_path != NULL) {
+        if (!load_checkpoints(resume_path, &checkpoints)) {
+            release_trace(processes, &file, &trace_bursts);
+            return 1;
+        }
+        if (!prepare_resume(&checkpoints, algo, &policy, processes, n, &resume)) {
+            release_checkpoints(&checkpoints);
+            release_trace(processes, &file, &trace_bursts);
+            return 2;
         }
+        if (checkpoint_every == 0)
+            checkpoint_every = checkpoints.settings.every;
+        if (resume.point != NULL)
+            resume_point = &resume;
+    }
+    if (checkpoint_out != NULL) {
+        checkpoint_log_init(&log, checkpoint_every > 0 ? checkpoint_every : CHECKPOINT_EVERY);
+        if (resume_point != NULL)
+            checked_run(checkpoint_log_append(&log, checkpoints.points, (int)(resume.point - checkpoints.points) + 1,
+                                              checkpoints.records));
+        checkpoint_log = &log;
     }
 
-    results[0] = total_wt / n;
-    results[1] = total_tat / n;
-    display_gantt_chart(gantt, *gantt_index);
-    print_results(processes, n, results[0], results[1]); 
-}
+    GanttLog *gantts = checked_alloc(cpus * sizeof(GanttLog));
+    memset(gantts, 0, cpus * sizeof(GanttLog));
+    float results[2];
+    if (cpus > 1)
+        run_algorithm_smp(algo, processes, n, results, gantts, quantum, cpus, &chart);
+    else
+        run_algorithm(algo, processes, n, results, &gantts[0], quantum, &chart);
+    if (at_time >= 0 || busy_from >= 0)
+        print_timeline_queries(gantts, cpus, at_time, busy_from, busy_to);
 
+    int status = 0;
+    if (gantt_out != NULL && !save_gantt(gantt_out, gantts, cpus))
+        status = 1;
+    if (results_out != NULL && !save_results(results_out, processes, n))
+        status = 1;
+    if (checkpoint_out != NULL &&
+        !save_checkpoints(checkpoint_out, &log, checkpoint_settings(algo, &policy, log.every), processes, n, &gantts[0]))
+        status = 1;
+    checkpoint_log = NULL;
+    resume_point = NULL;
+    checkpoint_log_free(&log);
+    release_checkpoints(&checkpoints);
+    for (int c = 0; c < cpus; c++)
+        gantt_free(&gantts[c]);
+    free(gantts);
+    release_trace(processes, &file, &trace_bursts);
+    return status;
+}
 
-int main() {
+int run_interactive(const ChartOptions *chart) {
     int choice, sub_choice, n, quantum = 1;  
-    GanttEntry gantt[100];
-    int gantt_index;
+    GanttLog gantt = { NULL, 0, 0, 0, 0 };
+    Process *processes = NULL, *copy = NULL;
+    int processes_capacity = 0, copy_capacity = 0;
     
     while (1) { // Loop for "Run Again?"
          
@@ -602,8 +3508,12 @@ int main() {
             continue;
         }
         while (getchar() != '\n');
+        if (n <= 0) {
+            printf("Invalid input! Number of processes must be positive.\n");
+            continue;
+        }
         
-        Process processes[n];
+        processes = checked_reserve(processes, &processes_capacity, n);
         input_processes(processes, n, algo_choice);
          
         if (choice == 3) {
@@ -616,43 +3526,23 @@ int main() {
             while (getchar() != '\n');
         }
  
-        if (!validate_inputs(processes, n, quantum)) {
+        Algorithm algo = ALGO_FCFS;
+        if (choice == 2)
+            algo = sub_choice == 1 ? ALGO_SJF : ALGO_SRTF;
+        else if (choice == 3)
+            algo = ALGO_RR;
+        else if (choice == 4)
+            algo = sub_choice == 1 ? ALGO_PRIORITY : ALGO_PRIORITY_PREEMPTIVE;
+        if (!validate_inputs(processes, n, quantum) || !validate_horizon(processes, n, algo, quantum)) {
             continue;  
         }
  
-        gantt_index = 0;
+        gantt_reset(&gantt);
         float results[2];
-        Process copy[n];
+        copy = checked_reserve(copy, &copy_capacity, n);
         reset_processes(copy, processes, n);
 
-        switch (choice) {
-            case 1:
-                printf("\n--- FCFS Scheduling ---\n");
-                fcfs(copy, n, results, gantt, &gantt_index);
-                break;
-            case 2:
-                if (sub_choice == 1) {
-                    printf("\n--- SJF (Non-Preemptive) Scheduling ---\n");
-                    sjf_non_preemptive(copy, n, results, gantt, &gantt_index);
-                } else {
-                    printf("\n--- SJF Preemptive (SRTF) Scheduling ---\n");
-                    sjf_preemptive(copy, n, results, gantt, &gantt_index);
-                }
-                break;
-            case 3:
-                printf("\n--- Round Robin Scheduling ---\n");
-                rr(copy, n, results, gantt, &gantt_index, quantum);
-                break;
-            case 4:
-                if (sub_choice == 1) {
-                    printf("\n--- Priority (Non-Preemptive) Scheduling ---\n");
-                    priority_non_preemptive(copy, n, results, gantt, &gantt_index);
-                } else {
-                    printf("\n--- Priority Preemptive Scheduling ---\n");
-                    priority_preemptive(copy, n, results, gantt, &gantt_index);
-                }
-                break;
-        }
+        run_algorithm(algo, copy, n, results, &gantt, quantum, chart);
  
         char run_again;
         printf("\nDo you want to run another simulation? (y/n): ");
@@ -663,5 +3553,16 @@ int main() {
         }
     }
     printf("Thank you for using the CPU Scheduler Simulator!\n");
+    gantt_free(&gantt);
+    free(processes);
+    free(copy);
     return 0;
 }
+
+int main(int argc, char *argv[]) {
+    PROFILE_INIT();
+    if (argc > 1)
+        return run_batch(argc, argv);
+    ChartOptions chart = { CHART_ANIMATED, 1000 };
+    return run_interactive(&chart);
+}
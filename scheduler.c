@@ -0,0 +1,2308 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include "scheduler_internal.h"
+
+#define HEAP_ARITY 4
+#define BUCKET_QUEUE_LIMIT 4096
+#define STEAL_PROBES 4
+
+#define CFS_TARGET_LATENCY 24       /* every runnable process should run once per period */
+#define CFS_MIN_GRANULARITY 3       /* shortest slice, however many processes are runnable */
+#define CFS_WAKEUP_GRANULARITY 4    /* vruntime lead an arrival needs to preempt */
+#define CFS_NICE_0_WEIGHT 1024
+
+#define ARENA_ALIGN 16      /* enough for any engine array */
+
+/*
+ * sched_simulate() points this at the caller's arena for the length of the
+ * run; otherwise the engine allocates from the heap. Each thread has its own,
+ * so runs on other threads are unaffected.
+ */
+static __thread SchedArena *engine_arena;
+
+/*
+ * Set when an allocation or a streamed arrival fails, for the run in progress
+ * to return. The work that needed it is skipped and the run stops at its next
+ * event.
+ */
+static __thread SchedStatus engine_error;
+
+static size_t arena_round(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static void *engine_alloc(size_t size) {
+    if (engine_arena != NULL) {
+        /* sched_simulate() checked the arena against sched_arena_size() before the run. */
+        void *ptr = (char *)engine_arena->base + engine_arena->used;
+        engine_arena->used += arena_round(size);
+        return ptr;
+    }
+    void *ptr = malloc(size);
+    if (ptr == NULL && size > 0)
+        engine_error = SCHED_ERR_MEMORY;
+    return ptr;
+}
+
+/* Arena memory is all handed back at once, when the caller resets the arena. */
+static void engine_free(void *ptr) {
+    if (engine_arena == NULL)
+        free(ptr);
+}
+
+typedef struct {
+    int arrival;
+    int idx;
+} ArrivalSlot;
+
+typedef struct {
+    int *items;
+    int count;
+    int capacity;
+} IndexHeap;
+
+/* Ready queue over a process table, ordered by the policy. */
+typedef struct {
+    const SchedPolicy *policy;
+    Process *procs;
+    long long *order;           /* per process, orders the queue ahead of the policy key when set */
+    int ranked;                 /* order holds each process's key and id, filled in by rq_push_at() */
+    ReadyQueueKind kind;
+    int count;
+    /* FIFO ring */
+    int *slots;
+    int capacity;
+    int head;
+    /* d-ary heap */
+    IndexHeap heap;
+    int arity;
+    /* pairing heap, intrusive links indexed by process */
+    int root;
+    int *child;
+    int *sibling;
+    /* bucket queue, one small heap per key value */
+    IndexHeap *buckets;
+    int bucket_count;
+    int min_bucket;
+} ReadyQueue;
+
+static int remaining_key(const Process *p) { return p->remaining_bt; }
+static int priority_key(const Process *p) { return p->priority; }
+static int arrival_key(const Process *p) { return p->arrival; }
+
+static int compare_arrival(const void *a, const void *b) {
+    const ArrivalSlot *x = a, *y = b;
+    if (x->arrival != y->arrival)
+        return x->arrival < y->arrival ? -1 : 1;
+    return x->idx - y->idx;
+}
+
+/* Process indices sorted by arrival, ties in input order; NULL when out of memory. */
+static int *arrival_order(const Process p[], int n) {
+    int *order = engine_alloc(n * sizeof(int));
+    if (order == NULL)
+        return NULL;
+    /* Traces are usually written in arrival order already, and then there is nothing to sort. */
+    int sorted = 1;
+    for (int i = 1; i < n && sorted; i++)
+        sorted = p[i - 1].arrival <= p[i].arrival;
+    if (sorted) {
+        for (int i = 0; i < n; i++)
+            order[i] = i;
+        return order;
+    }
+
+    ArrivalSlot *arrivals = engine_alloc(n * sizeof(ArrivalSlot));
+    if (arrivals == NULL) {
+        engine_free(order);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) {
+        arrivals[i].arrival = p[i].arrival;
+        arrivals[i].idx = i;
+    }
+    qsort(arrivals, n, sizeof(ArrivalSlot), compare_arrival);
+    for (int i = 0; i < n; i++)
+        order[i] = arrivals[i].idx;
+    engine_free(arrivals);
+    return order;
+}
+
+/* Ordering among ready processes: key, then lower id, then input order. */
+static int runs_before(const SchedPolicy *policy, const Process *a, const Process *b) {
+    int ka = policy->key(a), kb = policy->key(b);
+    if (ka != kb)
+        return ka < kb;
+    if (a->id != b->id)
+        return a->id < b->id;
+    return a < b;
+}
+
+/*
+ * The key in the high half and the id in the low half, so that ranked queues
+ * compare one column instead of calling the key on two table entries.
+ */
+static long long key_rank(const SchedPolicy *policy, const Process *p) {
+    return (long long)policy->key(p) * 4294967296LL + ((long long)p->id - INT_MIN);
+}
+
+static int queue_before(ReadyQueue *q, int a, int b) {
+    if (q->order != NULL && q->order[a] != q->order[b])
+        return q->order[a] < q->order[b];
+    return runs_before(q->policy, &q->procs[a], &q->procs[b]);
+}
+
+static int heap_push(ReadyQueue *q, IndexHeap *h, int idx) {
+    if (h->count == h->capacity) {
+        int capacity = h->capacity ? h->capacity * 2 : 16;
+        int *items = realloc(h->items, capacity * sizeof(int));
+        if (items == NULL) {
+            engine_error = SCHED_ERR_MEMORY;
+            return 0;
+        }
+        h->items = items;
+        h->capacity = capacity;
+    }
+    int pos = h->count++;
+    while (pos > 0) {
+        int parent = (pos - 1) / q->arity;
+        if (!queue_before(q, idx, h->items[parent]))
+            break;
+        h->items[pos] = h->items[parent];
+        pos = parent;
+    }
+    h->items[pos] = idx;
+    return 1;
+}
+
+static int heap_pop(ReadyQueue *q, IndexHeap *h) {
+    int top = h->items[0];
+    int last = h->items[--h->count];
+    int pos = 0;
+    while (1) {
+        int first = pos * q->arity + 1;
+        if (first >= h->count)
+            break;
+        int end = first + q->arity < h->count ? first + q->arity : h->count;
+        int best = first;
+        for (int c = first + 1; c < end; c++) {
+            if (queue_before(q, h->items[c], h->items[best]))
+                best = c;
+        }
+        if (!queue_before(q, h->items[best], last))
+            break;
+        h->items[pos] = h->items[best];
+        pos = best;
+    }
+    h->items[pos] = last;
+    return top;
+}
+
+static int pairing_merge(ReadyQueue *q, int a, int b) {
+    if (a == -1)
+        return b;
+    if (b == -1)
+        return a;
+    if (queue_before(q, b, a)) {
+        int swap = a;
+        a = b;
+        b = swap;
+    }
+    q->sibling[b] = q->child[a];
+    q->child[a] = b;
+    return a;
+}
+
+/* Standard two-pass combine of a detached child list. */
+static int pairing_combine(ReadyQueue *q, int first) {
+    int pairs = -1;
+    while (first != -1) {
+        int a = first, b = q->sibling[a];
+        if (b == -1) {
+            q->sibling[a] = pairs;
+            pairs = a;
+            break;
+        }
+        first = q->sibling[b];
+        q->sibling[a] = q->sibling[b] = -1;
+        int merged = pairing_merge(q, a, b);
+        q->sibling[merged] = pairs;
+        pairs = merged;
+    }
+
+    int root = -1;
+    while (pairs != -1) {
+        int next = q->sibling[pairs];
+        q->sibling[pairs] = -1;
+        root = pairing_merge(q, root, pairs);
+        pairs = next;
+    }
+    return root;
+}
+
+/*
+ * capacity is the initial number of slots; FIFO and heap queues grow past it.
+ * On an arena, which cannot grow them, they get room for all n processes.
+ */
+static void rq_init(ReadyQueue *q, const SchedPolicy *policy, Process p[], int n, int capacity) {
+    memset(q, 0, sizeof(*q));
+    q->policy = policy;
+    q->procs = p;
+    q->kind = policy->key == NULL ? RQ_FIFO : policy->queue;
+    q->root = -1;
+    if (engine_arena != NULL)
+        capacity = n;
+
+    /* Aged keys are not small integers, and the buckets' heaps grow one by one. */
+    if (q->kind == RQ_BUCKET_QUEUE && (policy->aging > 0 || engine_arena != NULL))
+        q->kind = RQ_DARY_HEAP;
+    if (q->kind == RQ_BUCKET_QUEUE) {
+        /* Keys never grow while a process waits, so the initial maximum bounds the range. */
+        int max_key = 0;
+        for (int i = 0; i < n; i++) {
+            int key = policy->key(&p[i]);
+            if (key < 0)
+                max_key = BUCKET_QUEUE_LIMIT;
+            if (key > max_key)
+                max_key = key;
+        }
+        if (max_key < BUCKET_QUEUE_LIMIT) {
+            q->bucket_count = max_key + 1;
+            q->min_bucket = q->bucket_count;
+            q->buckets = engine_alloc(q->bucket_count * sizeof(IndexHeap));
+            if (q->buckets == NULL) {
+                q->bucket_count = 0;
+                return;
+            }
+            memset(q->buckets, 0, q->bucket_count * sizeof(IndexHeap));
+            q->arity = 2;
+            return;
+        }
+        q->kind = RQ_DARY_HEAP;
+    }
+
+    switch (q->kind) {
+        case RQ_FIFO:
+            q->slots = engine_alloc(capacity * sizeof(int));
+            q->capacity = q->slots != NULL ? capacity : 0;
+            break;
+        case RQ_BINARY_HEAP:
+        case RQ_DARY_HEAP:
+            q->arity = q->kind == RQ_BINARY_HEAP ? 2 : HEAP_ARITY;
+            q->heap.items = engine_alloc(capacity * sizeof(int));
+            q->heap.capacity = q->heap.items != NULL ? capacity : 0;
+            break;
+        case RQ_PAIRING_HEAP:
+            q->child = engine_alloc(n * sizeof(int));
+            q->sibling = engine_alloc(n * sizeof(int));
+            break;
+        default:
+            break;
+    }
+}
+
+static void rq_free(ReadyQueue *q) {
+    engine_free(q->slots);
+    engine_free(q->heap.items);
+    engine_free(q->child);
+    engine_free(q->sibling);
+    for (int b = 0; b < q->bucket_count; b++)
+        engine_free(q->buckets[b].items);
+    engine_free(q->buckets);
+}
+
+/* Out of memory, idx is left out of the queue and engine_error is set. */
+static void rq_push(ReadyQueue *q, int idx) {
+    switch (q->kind) {
+        case RQ_FIFO:
+            if (q->count == q->capacity) {
+                int capacity = q->capacity ? q->capacity * 2 : 16;
+                int *slots = engine_alloc(capacity * sizeof(int));
+                if (slots == NULL)
+                    return;
+                for (int i = 0; i < q->count; i++)
+                    slots[i] = q->slots[(q->head + i) % q->capacity];
+                engine_free(q->slots);
+                q->slots = slots;
+                q->capacity = capacity;
+                q->head = 0;
+            }
+            q->slots[(q->head + q->count) % q->capacity] = idx;
+            break;
+        case RQ_BINARY_HEAP:
+        case RQ_DARY_HEAP:
+            if (!heap_push(q, &q->heap, idx))
+                return;
+            break;
+        case RQ_PAIRING_HEAP:
+            q->child[idx] = q->sibling[idx] = -1;
+            q->root = pairing_merge(q, q->root, idx);
+            break;
+        case RQ_BUCKET_QUEUE: {
+            int key = q->policy->key(&q->procs[idx]);
+            if (!heap_push(q, &q->buckets[key], idx))
+                return;
+            if (key < q->min_bucket)
+                q->min_bucket = key;
+            break;
+        }
+    }
+    q->count++;
+}
+
+static int rq_peek(ReadyQueue *q) {
+    if (q->count == 0)
+        return -1;
+    switch (q->kind) {
+        case RQ_FIFO:
+            return q->slots[q->head];
+        case RQ_BINARY_HEAP:
+        case RQ_DARY_HEAP:
+            return q->heap.items[0];
+        case RQ_PAIRING_HEAP:
+            return q->root;
+        case RQ_BUCKET_QUEUE:
+            while (q->buckets[q->min_bucket].count == 0)
+                q->min_bucket++;
+            return q->buckets[q->min_bucket].items[0];
+    }
+    return -1;
+}
+
+static int rq_pop(ReadyQueue *q) {
+    int idx = rq_peek(q);
+    if (idx == -1)
+        return -1;
+    switch (q->kind) {
+        case RQ_FIFO:
+            q->head = (q->head + 1) % q->capacity;
+            break;
+        case RQ_BINARY_HEAP:
+        case RQ_DARY_HEAP:
+            heap_pop(q, &q->heap);
+            break;
+        case RQ_PAIRING_HEAP:
+            q->root = pairing_combine(q, q->child[idx]);
+            break;
+        case RQ_BUCKET_QUEUE:
+            heap_pop(q, &q->buckets[q->min_bucket]);
+            break;
+    }
+    q->count--;
+    return idx;
+}
+
+/*
+ * Aging lowers a waiting process's key by one per policy->aging time units
+ * after since, when it joined the queue. All waiting processes age at the
+ * same rate, so their order never changes and key * aging + since can be
+ * fixed at push time instead of rescanning the queue.
+ */
+static void rq_push_at(ReadyQueue *q, int idx, int since) {
+    if (q->policy->aging > 0 && q->order != NULL)
+        q->order[idx] = (long long)q->policy->key(&q->procs[idx]) * q->policy->aging + since;
+    else if (q->ranked)
+        q->order[idx] = key_rank(q->policy, &q->procs[idx]);
+    rq_push(q, idx);
+}
+
+/*
+ * Marks idx as taking the CPU at now. It keeps the priority it aged to while
+ * it waited but ages no further while it runs, so from here on its order
+ * counts as order[idx] + now in rq_preempts().
+ */
+static void rq_dispatched(ReadyQueue *q, int idx, int now) {
+    if (q->policy->aging > 0 && q->order != NULL)
+        q->order[idx] -= now;
+}
+
+/*
+ * Whether the head of the queue should take the CPU from running at now. The
+ * running process's rank is stale once it has run, so ranked queues compare keys.
+ */
+static int rq_preempts(ReadyQueue *q, int running, int now) {
+    int best = rq_peek(q);
+    if (q->policy->aging > 0 && q->order != NULL)
+        return q->order[best] < q->order[running] + now;
+    if (q->order != NULL && !q->ranked)
+        return q->order[best] < q->order[running];
+    return q->policy->key(&q->procs[best]) < q->policy->key(&q->procs[running]);
+}
+
+/* Copies the queued processes to items, FIFO queues in queue order and heaps in any order; returns the count. */
+static int rq_items(const ReadyQueue *q, int *items) {
+    int count = 0;
+    switch (q->kind) {
+        case RQ_FIFO:
+            for (int i = 0; i < q->count; i++)
+                items[count++] = q->slots[(q->head + i) % q->capacity];
+            break;
+        case RQ_BINARY_HEAP:
+        case RQ_DARY_HEAP:
+            for (int i = 0; i < q->heap.count; i++)
+                items[count++] = q->heap.items[i];
+            break;
+        case RQ_PAIRING_HEAP:
+            /* Breadth first, with items as the work list. */
+            if (q->root != -1)
+                items[count++] = q->root;
+            for (int i = 0; i < count; i++) {
+                for (int c = q->child[items[i]]; c != -1; c = q->sibling[c])
+                    items[count++] = c;
+            }
+            break;
+        case RQ_BUCKET_QUEUE:
+            for (int b = q->min_bucket; b < q->bucket_count; b++) {
+                for (int i = 0; i < q->buckets[b].count; i++)
+                    items[count++] = q->buckets[b].items[i];
+            }
+            break;
+    }
+    return count;
+}
+
+/* Overhead of dispatching idx on a CPU whose previous process was last (-1 = none yet). */
+static int dispatch_overhead(const OverheadModel *model, int last, int idx) {
+    if (model == NULL)
+        return 0;
+    int cost = model->dispatch;
+    if (last != idx) {
+        cost += model->cache_warmup;
+        if (last != -1)
+            cost += model->context_switch;
+    }
+    return cost;
+}
+
+/* Resuming the process that just left off reopens its segment instead of starting a new one. */
+static void gantt_open(GanttLog *gantt, int id, int time) {
+    if (gantt == NULL)
+        return;
+    gantt->decisions++;
+    if (gantt->truncated)
+        return;
+    if (gantt->count > 0 && gantt->entries[gantt->count - 1].process_id == id &&
+        gantt->entries[gantt->count - 1].end_time == time) {
+        gantt->count--;
+        return;
+    }
+    if (gantt->count == gantt->capacity) {
+        /* sched_simulate() logs into the caller's buffer, which stays the size it was given. */
+        if (engine_arena != NULL) {
+            gantt->truncated = 1;
+            return;
+        }
+        int capacity = gantt->capacity ? gantt->capacity * 2 : 256;
+        GanttEntry *entries = realloc(gantt->entries, capacity * sizeof(GanttEntry));
+        if (entries == NULL) {
+            engine_error = SCHED_ERR_MEMORY;
+            gantt->truncated = 1;
+            return;
+        }
+        gantt->entries = entries;
+        gantt->capacity = capacity;
+    }
+    gantt->entries[gantt->count].process_id = id;
+    gantt->entries[gantt->count].start_time = time;
+}
+
+static void gantt_close(GanttLog *gantt, int time) {
+    if (gantt == NULL || gantt->truncated)
+        return;
+    gantt->entries[gantt->count].end_time = time;
+    gantt->count++;
+}
+
+static void gantt_add(GanttLog *gantt, int id, int start, int end) {
+    gantt_open(gantt, id, start);
+    gantt_close(gantt, end);
+}
+
+/* Keeps the storage so repeated runs reuse it without reallocating. */
+void gantt_reset(GanttLog *gantt) {
+    gantt->count = 0;
+    gantt->truncated = 0;
+    gantt->decisions = 0;
+}
+
+void gantt_free(GanttLog *gantt) {
+    free(gantt->entries);
+    gantt->entries = NULL;
+    gantt->count = gantt->capacity = gantt->truncated = 0;
+    gantt->decisions = 0;
+}
+
+SchedStatus timeline_build(Timeline *tl, const GanttLog *log) {
+    tl->log = log;
+    tl->busy_before = engine_alloc((log->count + 1) * sizeof(long long));
+    if (tl->busy_before == NULL)
+        return SCHED_ERR_MEMORY;
+    tl->busy_before[0] = 0;
+    for (int i = 0; i < log->count; i++) {
+        const GanttEntry *g = &log->entries[i];
+        tl->busy_before[i + 1] = tl->busy_before[i];
+        if (g->process_id != GANTT_OVERHEAD_ID)
+            tl->busy_before[i + 1] += g->end_time - g->start_time;
+    }
+    return SCHED_OK;
+}
+
+void timeline_free(Timeline *tl) {
+    engine_free(tl->busy_before);
+    tl->busy_before = NULL;
+}
+
+/* Number of segments that start before time. */
+static int timeline_before(const Timeline *tl, int time) {
+    int lo = 0, hi = tl->log->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (tl->log->entries[mid].start_time < time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Segment running at time, NULL if the CPU was idle. */
+const GanttEntry *timeline_at(const Timeline *tl, int time) {
+    int k = time == INT_MAX ? tl->log->count : timeline_before(tl, time + 1);
+    if (k == 0 || tl->log->entries[k - 1].end_time <= time)
+        return NULL;
+    return &tl->log->entries[k - 1];
+}
+
+/* Time processes ran before time. */
+static long long timeline_busy_until(const Timeline *tl, int time) {
+    int k = timeline_before(tl, time);
+    if (k == 0)
+        return 0;
+    const GanttEntry *g = &tl->log->entries[k - 1];
+    long long busy = tl->busy_before[k];
+    if (g->process_id != GANTT_OVERHEAD_ID && g->end_time > time)
+        busy -= g->end_time - time;
+    return busy;
+}
+
+/* Time processes ran in [from, to). */
+long long timeline_busy(const Timeline *tl, int from, int to) {
+    if (to <= from)
+        return 0;
+    return timeline_busy_until(tl, to) - timeline_busy_until(tl, from);
+}
+
+/* Grows table to n processes; NULL when out of memory, and table is left as it was. */
+Process *reserve_processes(Process *table, int *capacity, int n) {
+    if (n <= *capacity)
+        return table;
+    Process *grown = realloc(table, n * sizeof(Process));
+    if (grown == NULL)
+        return NULL;
+    *capacity = n;
+    return grown;
+}
+
+typedef struct {
+    ReadyQueue queue;   /* FIFO of processes waiting for the device */
+    int serving;        /* -1 = idle */
+    int done_at;        /* INT_MAX while idle */
+} IoDevice;
+
+/* Where each process is in its burst sequence, and the devices serving the I/O steps. */
+typedef struct {
+    const BurstPlan *plan;
+    SchedPolicy fifo;
+    int *step;          /* current step per process */
+    int *blocked;       /* time spent waiting for or doing I/O */
+    IoDevice *devices;
+    int device_count;
+} IoState;
+
+/* Puts every process on its first CPU burst; without a plan there are no devices and nothing blocks. */
+static void io_init(IoState *io, const BurstPlan *plan, Process p[], int n) {
+    memset(io, 0, sizeof(*io));
+    if (plan == NULL)
+        return;
+    SchedPolicy fifo = { NULL, 0, 0, RQ_FIFO, 0, NULL, NULL };
+    io->fifo = fifo;
+    io->step = engine_alloc(n * sizeof(int));
+    io->blocked = engine_alloc(n * sizeof(int));
+    io->devices = engine_alloc(plan->devices * sizeof(IoDevice));
+    if (io->step == NULL || io->blocked == NULL || io->devices == NULL)
+        return;
+    io->plan = plan;
+    memset(io->step, 0, n * sizeof(int));
+    memset(io->blocked, 0, n * sizeof(int));
+    io->device_count = plan->devices;
+    for (int d = 0; d < plan->devices; d++) {
+        rq_init(&io->devices[d].queue, &io->fifo, p, n, 16);
+        io->devices[d].serving = -1;
+        io->devices[d].done_at = INT_MAX;
+    }
+    for (int i = 0; i < n; i++) {
+        if (plan->first[i] < plan->first[i + 1])
+            p[i].remaining_bt = plan->steps[plan->first[i]].cpu;
+    }
+}
+
+static void io_free(IoState *io) {
+    for (int d = 0; d < io->device_count; d++)
+        rq_free(&io->devices[d].queue);
+    engine_free(io->devices);
+    engine_free(io->step);
+    engine_free(io->blocked);
+}
+
+/* Time of the next I/O completion, INT_MAX while every device is idle. */
+static int io_next_done(const IoState *io) {
+    int next = INT_MAX;
+    for (int d = 0; d < io->device_count; d++) {
+        if (io->devices[d].done_at < next)
+            next = io->devices[d].done_at;
+    }
+    return next;
+}
+
+static void io_serve(IoState *io, int d, int idx, int now) {
+    io->devices[d].serving = idx;
+    io->devices[d].done_at = now + io->plan->steps[io->plan->first[idx] + io->step[idx]].io;
+}
+
+/* Sends idx, whose CPU burst just ended, to its next I/O step. Returns 0 if it has none left. */
+static int io_block(IoState *io, int idx, int now) {
+    const BurstPlan *plan = io->plan;
+    if (plan == NULL || plan->first[idx] + io->step[idx] + 1 >= plan->first[idx + 1])
+        return 0;
+    io->step[idx]++;
+    io->blocked[idx] -= now;
+    int d = plan->steps[plan->first[idx] + io->step[idx]].device;
+    if (io->devices[d].serving == -1)
+        io_serve(io, d, idx, now);
+    else
+        rq_push(&io->devices[d].queue, idx);
+    return 1;
+}
+
+/* Finishes the earliest I/O, lowest device first on ties, and returns the process it readies. */
+static int io_wake(IoState *io, Process p[]) {
+    int d = 0;
+    for (int k = 1; k < io->device_count; k++) {
+        if (io->devices[k].done_at < io->devices[d].done_at)
+            d = k;
+    }
+    IoDevice *dev = &io->devices[d];
+    int idx = dev->serving, now = dev->done_at;
+    io->blocked[idx] += now;
+    p[idx].remaining_bt = io->plan->steps[io->plan->first[idx] + io->step[idx]].cpu;
+    int queued = rq_pop(&dev->queue);
+    if (queued == -1) {
+        dev->serving = -1;
+        dev->done_at = INT_MAX;
+    } else {
+        io_serve(io, d, queued, now);
+    }
+    return idx;
+}
+
+/*
+ * Where the engine's processes come from. A table is admitted through order[],
+ * its arrival order. A stream is read one process ahead, and its processes live
+ * in slots of a table that grows while more are in flight at once and is reused
+ * as they finish.
+ */
+typedef struct {
+    Process *p;
+    int *order;             /* table only */
+    int n;                  /* table only */
+    int next;               /* processes admitted so far */
+    SchedStream *stream;    /* NULL for a table */
+    Process pending;        /* the stream's next arrival while have > 0 */
+    int have;
+    int last_arrival;
+    long long busy_until;   /* stream only: when the admitted processes are done at the latest */
+    int capacity;
+    int *free_slots;
+    int free_count;
+} Arrivals;
+
+static inline int next_arrival(const Arrivals *a) {
+    if (a->stream != NULL)
+        return a->have > 0 ? a->pending.arrival : INT_MAX;
+    return a->next < a->n ? a->p[a->order[a->next]].arrival : INT_MAX;
+}
+
+static inline int arrivals_left(const Arrivals *a) {
+    return a->stream != NULL ? a->have > 0 : a->next < a->n;
+}
+
+static int next_event(const Arrivals *a, const IoState *io) {
+    int arrival = next_arrival(a);
+    int done = io_next_done(io);
+    return done < arrival ? done : arrival;
+}
+
+/*
+ * Queues the arrivals and I/O completions due by now in time order, arrivals
+ * first on ties, each stamped with the time it became ready.
+ */
+static void admit_with_io(ReadyQueue *rq, Arrivals *a, IoState *io, int now) {
+    while (1) {
+        int arrival = next_arrival(a);
+        int done = io_next_done(io);
+        if (arrival <= done && arrival <= now) {
+            int idx = a->order[a->next++];
+            rq_push_at(rq, idx, arrival);
+        } else if (done < arrival && done <= now) {
+            rq_push_at(rq, io_wake(io, a->p), done);
+        } else {
+            return;
+        }
+    }
+}
+
+/*
+ * Longest a process can keep a CPU or device busy: its CPU and I/O time and
+ * the overhead of every dispatch. A dispatch either runs a slice or loses
+ * the CPU to an arrival or wake-up, and there is one of those per CPU burst.
+ * Saturates just past INT_MAX.
+ */
+static long long busy_bound(const SchedPolicy *policy, const BurstStep steps[], int count) {
+    const OverheadModel *o = policy->overhead;
+    long long cost = o != NULL ? (long long)o->context_switch + o->dispatch + o->cache_warmup : 0;
+    long long busy = 0, dispatches = 0;
+    for (int s = 0; s < count; s++) {
+        busy += (long long)steps[s].io + steps[s].cpu;
+        dispatches += 1 + (policy->quantum > 0 ? (steps[s].cpu + policy->quantum - 1LL) / policy->quantum : 1);
+    }
+    if (busy > INT_MAX || (cost > 0 && dispatches > (INT_MAX - busy) / cost))
+        return (long long)INT_MAX + 1;
+    return busy + dispatches * cost;
+}
+
+/*
+ * Whether the table is done by INT_MAX under policy, so the clock and the
+ * times cannot overflow: once the last process has arrived, some CPU or
+ * device stays busy until all of them finish.
+ */
+int sched_time_fits(const SchedPolicy *policy, const Process p[], int n) {
+    const BurstPlan *plan = policy->bursts;
+    long long last_arrival = 0, busy = 0;
+    for (int i = 0; i < n; i++) {
+        BurstStep whole = { 0, 0, p[i].burst };
+        if (plan != NULL && plan->first != NULL && plan->first[i + 1] > plan->first[i])
+            busy += busy_bound(policy, &plan->steps[plan->first[i]], plan->first[i + 1] - plan->first[i]);
+        else
+            busy += busy_bound(policy, &whole, 1);
+        if (p[i].arrival > last_arrival)
+            last_arrival = p[i].arrival;
+        if (last_arrival + busy > INT_MAX)
+            return 0;
+    }
+    return 1;
+}
+
+/* Doubles the stream's slots; the queue indexes the moved table from then on. Returns 0 when out of memory. */
+static int stream_grow(Arrivals *a, ReadyQueue *rq) {
+    int capacity = a->capacity;
+    Process *grown = reserve_processes(a->p, &capacity, capacity ? capacity * 2 : 256);
+    int *free_slots = realloc(a->free_slots, capacity * sizeof(int));
+    long long *order = rq->policy->key != NULL ? realloc(rq->order, capacity * sizeof(long long)) : rq->order;
+    if (grown != NULL)
+        a->p = rq->procs = grown;
+    if (free_slots != NULL)
+        a->free_slots = free_slots;
+    if (order != NULL)
+        rq->order = order;
+    if (grown == NULL || free_slots == NULL || (rq->policy->key != NULL && order == NULL)) {
+        engine_error = SCHED_ERR_MEMORY;
+        return 0;
+    }
+    for (int i = capacity - 1; i >= a->capacity; i--)
+        a->free_slots[a->free_count++] = i;
+    a->capacity = capacity;
+    return 1;
+}
+
+/*
+ * Queues the stream's arrivals due by now, stopping at the first invalid or
+ * out-of-order one, or at one that could keep the clock running past INT_MAX.
+ */
+static void admit_stream(ReadyQueue *rq, Arrivals *a, int now) {
+    SchedStream *s = a->stream;
+    while (a->have > 0 && a->pending.arrival <= now) {
+        if (a->pending.arrival < a->last_arrival || a->pending.arrival < 0 || a->pending.burst <= 0 ||
+            a->pending.priority < 0) {
+            engine_error = SCHED_ERR_CONFIG;
+            return;
+        }
+        BurstStep whole = { 0, 0, a->pending.burst };
+        if (a->busy_until < a->pending.arrival)
+            a->busy_until = a->pending.arrival;
+        a->busy_until += busy_bound(rq->policy, &whole, 1);
+        if (a->busy_until > INT_MAX) {
+            engine_error = SCHED_ERR_CONFIG;
+            return;
+        }
+        if (a->free_count == 0 && !stream_grow(a, rq))
+            return;
+        a->last_arrival = a->pending.arrival;
+        int slot = a->free_slots[--a->free_count];
+        a->p[slot] = a->pending;
+        rq_push_at(rq, slot, a->pending.arrival);
+        a->next++;
+        if (++s->in_flight > s->peak_in_flight)
+            s->peak_in_flight = s->in_flight;
+        a->have = s->next(s->ctx, &a->pending);
+        if (a->have < 0)
+            engine_error = SCHED_ERR_STREAM;
+    }
+}
+
+/*
+ * Small enough to inline, so table runs without I/O keep their tight arrival
+ * loop. Returns the process table, which moves when a stream outgrows it.
+ */
+static inline Process *admit_ready(ReadyQueue *rq, Arrivals *a, IoState *io, int now) {
+    if (a->stream != NULL) {
+        admit_stream(rq, a, now);
+    } else if (io->device_count > 0) {
+        admit_with_io(rq, a, io, now);
+    } else {
+        int next = a->next;
+        while (next < a->n && a->p[a->order[next]].arrival <= now) {
+            int idx = a->order[next++];
+            rq_push_at(rq, idx, a->p[idx].arrival);
+        }
+        a->next = next;
+    }
+    return a->p;
+}
+
+/* Hands a finished stream process to the caller and frees its slot. */
+static void stream_finish(Arrivals *a, int idx) {
+    SchedStream *s = a->stream;
+    s->in_flight--;
+    s->finished(s->ctx, &a->p[idx]);
+    a->free_slots[a->free_count++] = idx;
+}
+
+void checkpoint_log_init(CheckpointLog *log, int every) {
+    memset(log, 0, sizeof(*log));
+    log->every = every;
+    log->next_at = every;
+}
+
+void checkpoint_log_free(CheckpointLog *log) {
+    free(log->points);
+    free(log->records);
+    memset(log, 0, sizeof(*log));
+}
+
+/* Makes room for one more checkpoint with records process records; returns 0 when out of memory. */
+static int checkpoint_log_reserve(CheckpointLog *log, long long records) {
+    if (log->count == log->capacity) {
+        int capacity = log->capacity ? log->capacity * 2 : 64;
+        Checkpoint *points = realloc(log->points, capacity * sizeof(Checkpoint));
+        if (points == NULL)
+            return 0;
+        log->points = points;
+        log->capacity = capacity;
+    }
+    if (log->record_count + records > log->record_capacity) {
+        long long capacity = log->record_capacity ? log->record_capacity * 2 : 1024;
+        while (capacity < log->record_count + records)
+            capacity *= 2;
+        CheckpointProcess *grown = realloc(log->records, capacity * sizeof(CheckpointProcess));
+        if (grown == NULL)
+            return 0;
+        log->records = grown;
+        log->record_capacity = capacity;
+    }
+    return 1;
+}
+
+/*
+ * Appends count checkpoints of another run, whose first_record fields index
+ * records, and schedules the next one after the last of them.
+ */
+SchedStatus checkpoint_log_append(CheckpointLog *log, const Checkpoint points[], int count,
+                                  const CheckpointProcess records[]) {
+    for (int i = 0; i < count; i++) {
+        if (!checkpoint_log_reserve(log, points[i].active))
+            return SCHED_ERR_MEMORY;
+        Checkpoint copy = points[i];
+        copy.first_record = log->record_count;
+        if (points[i].active > 0)
+            memcpy(log->records + log->record_count, records + points[i].first_record,
+                   points[i].active * sizeof(CheckpointProcess));
+        log->record_count += points[i].active;
+        log->points[log->count++] = copy;
+    }
+    if (count > 0)
+        log->next_at = ((long long)points[count - 1].time / log->every + 1) * log->every;
+    return SCHED_OK;
+}
+
+/* Appends the engine state at time to log; items has room for every process. */
+static void checkpoint_take(CheckpointLog *log, const Process p[], const ReadyQueue *rq, int *items,
+                            const GanttLog *gantt, int time, int next, int running, int last_ran, int last_started) {
+    int active = rq_items(rq, items);
+    if (running != -1)
+        items[active++] = running;
+    if (!checkpoint_log_reserve(log, active)) {
+        engine_error = SCHED_ERR_MEMORY;
+        return;
+    }
+
+    Checkpoint point;
+    memset(&point, 0, sizeof(point));
+    point.time = time;
+    point.next = next;
+    point.running = running;
+    point.last_ran = last_ran;
+    point.last_started = last_started;
+    point.active = active;
+    point.first_record = log->record_count;
+    if (gantt != NULL) {
+        point.gantt_count = gantt->count;
+        if (point.running != -1)
+            point.open_start = gantt->entries[gantt->count].start_time;
+        if (gantt->count > 0)
+            point.gantt_last = gantt->entries[gantt->count - 1];
+    }
+    for (int i = 0; i < active; i++) {
+        CheckpointProcess *record = &log->records[log->record_count++];
+        int idx = items[i];
+        record->idx = idx;
+        record->remaining_bt = p[idx].remaining_bt;
+        record->rt = p[idx].rt;
+        record->reserved = 0;
+        record->order = rq->order != NULL && !rq->ranked ? rq->order[idx] : 0;
+    }
+    log->points[log->count++] = point;
+    log->next_at = ((long long)point.time / log->every + 1) * log->every;
+}
+
+/*
+ * Puts back the state of resume->point: results of the processes that had
+ * completed, the ready queue and the Gantt log up to then. Heaps pop in a
+ * total order, so pushing their records in any order rebuilds the same queue.
+ */
+static void checkpoint_restore(const ResumePoint *resume, Process p[], const int *order, ReadyQueue *rq,
+                               GanttLog *gantt) {
+    const Checkpoint *point = resume->point;
+    for (int i = 0; i < point->next; i++)
+        p[order[i]] = resume->base[order[i]];
+    for (int i = 0; i < point->active; i++) {
+        const CheckpointProcess *record = &resume->records[point->first_record + i];
+        p[record->idx].remaining_bt = record->remaining_bt;
+        p[record->idx].rt = record->rt;
+        if (rq->ranked)
+            rq->order[record->idx] = key_rank(rq->policy, &p[record->idx]);
+        else if (rq->order != NULL)
+            rq->order[record->idx] = record->order;
+        if (record->idx != point->running)
+            rq_push(rq, record->idx);
+    }
+
+    if (gantt == NULL)
+        return;
+    int count = point->gantt_count;
+    if (gantt->capacity <= count) {
+        GanttEntry *entries = realloc(gantt->entries, (count + 256) * sizeof(GanttEntry));
+        if (entries == NULL) {
+            engine_error = SCHED_ERR_MEMORY;
+            return;
+        }
+        gantt->entries = entries;
+        gantt->capacity = count + 256;
+    }
+    if (count > 0) {
+        memcpy(gantt->entries, resume->gantt, count * sizeof(GanttEntry));
+        gantt->entries[count - 1] = point->gantt_last;
+    }
+    if (point->running != -1) {
+        gantt->entries[count].process_id = p[point->running].id;
+        gantt->entries[count].start_time = point->open_start;
+    }
+    gantt->count = count;
+}
+
+/*
+ * Discrete-event core shared by the schedulers. Time jumps straight to the
+ * next arrival, completion, quantum expiry or end of I/O, so the cost depends
+ * on the number of events rather than on the length of the simulated timeline.
+ */
+static SchedStatus simulate(Process p[], int n, const SchedPolicy *policy, GanttLog *gantt) {
+    return simulate_budgeted(p, n, policy, gantt, NULL);
+}
+
+static SchedStatus simulate_events(Process p[], int n, const SchedPolicy *policy, GanttLog *gantt, CostBudget *budget,
+                           CheckpointLog *log, const ResumePoint *resume, SchedStream *stream);
+
+/*
+ * simulate() with an optional cost budget; gantt may be NULL when only the
+ * metrics are needed. Returns SCHED_STOPPED if the run stopped early on
+ * budget->limit.
+ */
+SchedStatus simulate_budgeted(Process p[], int n, const SchedPolicy *policy, GanttLog *gantt, CostBudget *budget) {
+    SchedStatus status;
+    PROFILE_TIME(PHASE_ENGINE, status = simulate_events(p, n, policy, gantt, budget, NULL, NULL, NULL));
+    return status;
+}
+
+/*
+ * simulate() that checkpoints into log and/or starts from resume instead of
+ * the first arrival; either may be NULL. Every process that arrives by the
+ * checkpoint's time must match the run the checkpoint was taken in.
+ */
+static SchedStatus simulate_checkpointed(Process p[], int n, const SchedPolicy *policy, GanttLog *gantt,
+                                         CheckpointLog *log, const ResumePoint *resume) {
+    SchedStatus status;
+    PROFILE_TIME(PHASE_ENGINE, status = simulate_events(p, n, policy, gantt, NULL, log, resume, NULL));
+    return status;
+}
+
+/*
+ * With a stream, p and n are unused: processes come from stream->next() in
+ * arrival order and go to stream->finished() as they complete.
+ */
+static SchedStatus simulate_events(Process p[], int n, const SchedPolicy *policy, GanttLog *gantt,
+                                   CostBudget *budget, CheckpointLog *log, const ResumePoint *resume,
+                                   SchedStream *stream) {
+    Arrivals arr;
+    memset(&arr, 0, sizeof(arr));
+    arr.stream = stream;
+    engine_error = SCHED_OK;
+    if (stream != NULL) {
+        n = 0;
+        arr.have = stream->next(stream->ctx, &arr.pending);
+        if (arr.have <= 0)
+            return arr.have == 0 ? SCHED_OK : SCHED_ERR_STREAM;
+    } else {
+        if (n <= 0)
+            return SCHED_OK;
+        arr.p = p;
+        arr.n = n;
+        PROFILE_TIME(PHASE_SORT, arr.order = arrival_order(p, n));
+        if (arr.order == NULL)
+            return SCHED_ERR_MEMORY;
+    }
+    ReadyQueue rq;
+    rq_init(&rq, policy, p, n, stream != NULL ? 16 : n);
+    if (policy->key != NULL) {
+        rq.order = engine_alloc(n * sizeof(long long));
+        rq.ranked = policy->aging <= 0;
+    }
+    IoState io;
+    io_init(&io, policy->bursts, p, n);
+    int *items = log != NULL ? engine_alloc(n * sizeof(int)) : NULL;
+
+    /*
+     * last_started trails last_ran when a dispatch lost the CPU during its
+     * overhead. Both are -2 once a stream process finishes, as its slot is
+     * about to be reused.
+     */
+    int completed = 0, running = -1, last_ran = -1, last_started = -1;
+    int current_time = next_arrival(&arr);
+    if (resume != NULL && engine_error == SCHED_OK) {
+        const Checkpoint *point = resume->point;
+        checkpoint_restore(resume, p, arr.order, &rq, gantt);
+        arr.next = point->next;
+        completed = point->next - point->active;
+        running = point->running;
+        last_ran = point->last_ran;
+        last_started = point->last_started;
+        current_time = point->time;
+    }
+    PROFILE_COUNTERS();
+    PROFILE_COUNT(COUNT_RUNS, 1);
+
+    while (engine_error == SCHED_OK && (arrivals_left(&arr) || completed < arr.next)) {
+        PROFILE_EVENT();
+        if (log != NULL && current_time >= log->next_at)
+            checkpoint_take(log, p, &rq, items, gantt, current_time, arr.next, running, last_ran, last_started);
+        PROFILE_SAMPLE(PHASE_ADMIT, p = admit_ready(&rq, &arr, &io, current_time));
+
+        if (running == -1) {
+            PROFILE_SAMPLE(PHASE_SELECT, running = rq_pop(&rq));
+            if (running == -1) {
+                int event = next_event(&arr, &io);
+                PROFILE_COUNT(COUNT_IDLE_JUMPS, 1);
+                PROFILE_COUNT(COUNT_IDLE_SKIPPED, event - current_time);
+                current_time = event;
+                continue;
+            }
+            rq_dispatched(&rq, running, current_time);
+            int overhead = dispatch_overhead(policy->overhead, last_ran, running);
+            last_ran = running;
+            if (overhead > 0) {
+                PROFILE_COUNT(COUNT_CHARGED, 1);
+                gantt_add(gantt, GANTT_OVERHEAD_ID, current_time, current_time + overhead);
+                current_time += overhead;
+                if (stream != NULL)
+                    stream->overhead += overhead;
+                /* Arrivals during the switch can still take the CPU before the process starts. */
+                p = admit_ready(&rq, &arr, &io, current_time);
+                if (policy->preemptive && rq.count > 0 && rq_preempts(&rq, running, current_time)) {
+                    PROFILE_COUNT(COUNT_SWITCH_PREEMPTIONS, 1);
+                    rq_push_at(&rq, running, current_time);
+                    running = -1;
+                    continue;
+                }
+            }
+            if (last_started != -1 && last_started != running) {
+                if (stream != NULL)
+                    stream->switches++;
+                if (budget) {
+                    budget->switches++;
+                    budget->cost += budget->switch_weight;
+                    if (budget->cost > budget->limit)
+                        break;
+                }
+            }
+            last_started = running;
+            PROFILE_SAMPLE(PHASE_GANTT, gantt_open(gantt, p[running].id, current_time));
+            if (p[running].rt < 0)
+                p[running].rt = current_time - p[running].arrival;
+        }
+
+        int slice = p[running].remaining_bt;
+        if (policy->quantum > 0 && slice > policy->quantum)
+            slice = policy->quantum;
+        int run_end = current_time + slice;
+        int event = next_event(&arr, &io);
+
+        if (policy->preemptive && event < run_end) {
+            p[running].remaining_bt -= event - current_time;
+            current_time = event;
+            PROFILE_SAMPLE(PHASE_ADMIT, p = admit_ready(&rq, &arr, &io, current_time));
+            /* What the queue could not take is lost, and the queue may be empty. */
+            if (engine_error != SCHED_OK)
+                break;
+
+            /* Every arrival or wake-up starts a new segment; ties keep the running process. */
+            PROFILE_SAMPLE(PHASE_GANTT, gantt_close(gantt, current_time));
+            int preempt;
+            PROFILE_SAMPLE(PHASE_SELECT, preempt = rq_preempts(&rq, running, current_time));
+            if (preempt) {
+                PROFILE_COUNT(COUNT_PREEMPTIONS, 1);
+                rq_push_at(&rq, running, current_time);
+                running = -1;
+            } else {
+                PROFILE_COUNT(COUNT_KEPT, 1);
+                PROFILE_SAMPLE(PHASE_GANTT, gantt_open(gantt, p[running].id, current_time));
+            }
+            continue;
+        }
+
+        p[running].remaining_bt -= slice;
+        current_time = run_end;
+        PROFILE_SAMPLE(PHASE_ADMIT, p = admit_ready(&rq, &arr, &io, current_time));
+        PROFILE_SAMPLE(PHASE_GANTT, gantt_close(gantt, current_time));
+
+        if (p[running].remaining_bt == 0 && !io_block(&io, running, current_time)) {
+            p[running].ct = current_time;
+            p[running].tat = current_time - p[running].arrival;
+            p[running].waiting = p[running].tat - p[running].burst - (io.blocked ? io.blocked[running] : 0);
+            completed++;
+            if (stream != NULL) {
+                stream_finish(&arr, running);
+                last_ran = last_started = -2;
+            }
+            if (budget) {
+                budget->cost += budget->waiting_weight * p[running].waiting + budget->tat_weight * p[running].tat;
+                if (budget->cost > budget->limit) {
+                    running = -1;
+                    break;
+                }
+            }
+        } else if (p[running].remaining_bt > 0) {
+            PROFILE_COUNT(COUNT_EXPIRIES, 1);
+            rq_push_at(&rq, running, current_time);
+        } else {
+            PROFILE_COUNT(COUNT_IO_BLOCKS, 1);
+        }
+        running = -1;
+    }
+    PROFILE_COUNT(COUNT_ADMITTED, arr.next);
+    PROFILE_COUNTERS_ADD();
+
+    engine_free(arr.order);
+    engine_free(items);
+    engine_free(rq.order);
+    rq_free(&rq);
+    io_free(&io);
+    if (stream != NULL) {
+        free(arr.p);
+        free(arr.free_slots);
+    }
+    if (engine_error == SCHED_OK && completed < n) {
+        budget->stopped = 1;
+        return SCHED_STOPPED;
+    }
+    return engine_error;
+}
+
+/*
+ * Bucket and pairing queues size their arrays from the whole process table,
+ * so queues that grow on demand use the d-ary heap instead. The run order is
+ * the same either way.
+ */
+static SchedPolicy growable_policy(const SchedPolicy *policy) {
+    SchedPolicy local = *policy;
+    if (local.queue == RQ_BUCKET_QUEUE || local.queue == RQ_PAIRING_HEAP)
+        local.queue = RQ_DARY_HEAP;
+    return local;
+}
+
+/*
+ * simulate() over processes read from stream as the clock reaches them. Their
+ * slots are recycled as soon as they finish, so memory follows the number of
+ * processes in flight rather than the length of the stream. An arrival that
+ * is out of order or invalid stops the run with SCHED_ERR_CONFIG.
+ */
+SchedStatus simulate_stream(SchedStream *stream, const SchedPolicy *policy) {
+    SchedPolicy local = growable_policy(policy);
+    SchedStatus status;
+    PROFILE_TIME(PHASE_ENGINE, status = simulate_events(NULL, 0, &local, NULL, NULL, NULL, NULL, stream));
+    return status;
+}
+
+typedef struct {
+    ReadyQueue rq;
+    int running;        /* -1 while idle */
+    int slice_end;      /* next event on this CPU, INT_MAX while idle */
+    int run_start;      /* time remaining_bt of the running process was last updated */
+    int touched;        /* needs a dispatch decision at the current time */
+    int idle_listed;
+    int last_ran;       /* process that last held this CPU, -1 = none */
+    int switching;      /* slice_end is the end of dispatch overhead */
+    int starting;       /* overhead just ended, the process has not started yet */
+} CpuState;
+
+typedef struct {
+    Process *p;
+    const SchedPolicy *policy;
+    CpuState *cpu;
+    int cpu_count;
+    int *events;        /* binary heap of CPUs ordered by slice_end */
+    int *event_pos;
+    int *idle;          /* stack of CPUs that went idle with an empty queue */
+    int idle_count;
+    int *touched;
+    int touched_count;
+    int *last_cpu;      /* per process, -1 until first dispatched */
+    int stealable;      /* queued processes without an affinity */
+    unsigned place_cursor;
+    unsigned steal_cursor;
+    GanttLog *gantts;
+    SmpStats *stats;
+} SmpState;
+
+static int cpu_event_before(SmpState *s, int a, int b) {
+    if (s->cpu[a].slice_end != s->cpu[b].slice_end)
+        return s->cpu[a].slice_end < s->cpu[b].slice_end;
+    return a < b;
+}
+
+static void cpu_event_update(SmpState *s, int c, int time) {
+    int pos = s->event_pos[c];
+    s->cpu[c].slice_end = time;
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!cpu_event_before(s, c, s->events[parent]))
+            break;
+        s->events[pos] = s->events[parent];
+        s->event_pos[s->events[pos]] = pos;
+        pos = parent;
+    }
+    while (1) {
+        int child = 2 * pos + 1;
+        if (child >= s->cpu_count)
+            break;
+        if (child + 1 < s->cpu_count && cpu_event_before(s, s->events[child + 1], s->events[child]))
+            child++;
+        if (!cpu_event_before(s, s->events[child], c))
+            break;
+        s->events[pos] = s->events[child];
+        s->event_pos[s->events[pos]] = pos;
+        pos = child;
+    }
+    s->events[pos] = c;
+    s->event_pos[c] = pos;
+}
+
+static void cpu_touch(SmpState *s, int c) {
+    if (!s->cpu[c].touched) {
+        s->cpu[c].touched = 1;
+        s->touched[s->touched_count++] = c;
+    }
+}
+
+static void cpu_enqueue(SmpState *s, int c, int idx, int now) {
+    rq_push_at(&s->cpu[c].rq, idx, now);
+    if (s->p[idx].cpu < 0)
+        s->stealable++;
+    cpu_touch(s, c);
+}
+
+static int cpu_dequeue(SmpState *s, int c) {
+    int idx = rq_pop(&s->cpu[c].rq);
+    if (idx != -1 && s->p[idx].cpu < 0)
+        s->stealable--;
+    return idx;
+}
+
+static int cpu_load(SmpState *s, int c) {
+    return s->cpu[c].rq.count + (s->cpu[c].running != -1);
+}
+
+/*
+ * Pinned processes go to their CPU. Others take an idle CPU if there is one,
+ * otherwise the less loaded of a fixed home CPU and a rotating candidate.
+ */
+static int place_process(SmpState *s, int idx) {
+    if (s->p[idx].cpu >= 0)
+        return s->p[idx].cpu;
+    while (s->idle_count > 0) {
+        int c = s->idle[--s->idle_count];
+        s->cpu[c].idle_listed = 0;
+        if (s->cpu[c].running == -1)
+            return c;
+    }
+    int home = idx % s->cpu_count;
+    int other = s->place_cursor++ % s->cpu_count;
+    return cpu_load(s, other) < cpu_load(s, home) ? other : home;
+}
+
+/*
+ * Pulls the head of the longest queue among STEAL_PROBES rotating victims,
+ * falling back to a full scan only while unpinned work is queued somewhere.
+ * Pinned heads are never taken.
+ */
+static int steal_process(SmpState *s, int thief) {
+    if (s->stealable == 0)
+        return -1;
+    int victim = -1, longest = 0;
+    for (int k = 0; k < STEAL_PROBES && k < s->cpu_count; k++) {
+        int c = s->steal_cursor++ % s->cpu_count;
+        ReadyQueue *rq = &s->cpu[c].rq;
+        if (c != thief && rq->count > longest && s->p[rq_peek(rq)].cpu < 0) {
+            victim = c;
+            longest = rq->count;
+        }
+    }
+    for (int c = 0; victim == -1 && c < s->cpu_count; c++) {
+        ReadyQueue *rq = &s->cpu[c].rq;
+        if (c != thief && rq->count > longest && s->p[rq_peek(rq)].cpu < 0) {
+            victim = c;
+            longest = rq->count;
+        }
+    }
+    if (victim == -1)
+        return -1;
+    s->stats->steals++;
+    return cpu_dequeue(s, victim);
+}
+
+static void cpu_start(SmpState *s, int c, int now) {
+    Process *p = s->p;
+    CpuState *cpu = &s->cpu[c];
+    int idx = cpu->running;
+    cpu->run_start = now;
+    if (p[idx].rt < 0)
+        p[idx].rt = now - p[idx].arrival;
+    if (s->gantts)
+        gantt_open(&s->gantts[c], p[idx].id, now);
+
+    int slice = p[idx].remaining_bt;
+    if (s->policy->quantum > 0 && slice > s->policy->quantum)
+        slice = s->policy->quantum;
+    cpu_event_update(s, c, now + slice);
+}
+
+/* With dispatch overhead the process starts once the overhead event fires. */
+static void cpu_dispatch(SmpState *s, int c, int idx, int now) {
+    CpuState *cpu = &s->cpu[c];
+    cpu->running = idx;
+    rq_dispatched(&cpu->rq, idx, now);
+    if (s->last_cpu[idx] != -1 && s->last_cpu[idx] != c)
+        s->stats->migrations++;
+    s->last_cpu[idx] = c;
+    int overhead = dispatch_overhead(s->policy->overhead, cpu->last_ran, idx);
+    cpu->last_ran = idx;
+    if (overhead > 0) {
+        if (s->gantts)
+            gantt_add(&s->gantts[c], GANTT_OVERHEAD_ID, now, now + overhead);
+        cpu->switching = 1;
+        cpu_event_update(s, c, now + overhead);
+        return;
+    }
+    cpu_start(s, c, now);
+}
+
+/*
+ * simulate() on cpus CPUs, each with its own ready queue. Arrivals are placed
+ * by place_process() and a CPU that runs dry steals from a loaded one
+ * whenever unpinned work is left queued. Events are kept
+ * in a heap over the CPUs, so each costs O(log cpus) plus the queue
+ * operation. gantts holds one log per CPU and may be NULL.
+ */
+SchedStatus simulate_smp(Process p[], int n, const SchedPolicy *policy, int cpus, GanttLog gantts[],
+                         SmpStats *stats) {
+    stats->migrations = stats->steals = 0;
+    if (n <= 0 || cpus <= 0)
+        return SCHED_OK;
+    engine_error = SCHED_OK;
+
+    SchedPolicy local = growable_policy(policy);
+
+    SmpState s;
+    memset(&s, 0, sizeof(s));
+    s.p = p;
+    s.policy = &local;
+    s.cpu_count = cpus;
+    s.gantts = gantts;
+    s.stats = stats;
+    s.cpu = engine_alloc(cpus * sizeof(CpuState));
+    s.events = engine_alloc(cpus * sizeof(int));
+    s.event_pos = engine_alloc(cpus * sizeof(int));
+    s.idle = engine_alloc(cpus * sizeof(int));
+    s.touched = engine_alloc(cpus * sizeof(int));
+    s.last_cpu = engine_alloc(n * sizeof(int));
+    /* Ranks and aged keys are per process, so every CPU queue shares one array. */
+    long long *ranks = local.key != NULL ? engine_alloc(n * sizeof(long long)) : NULL;
+    int *order = arrival_order(p, n);
+    int *expired = engine_alloc(cpus * sizeof(int));
+    /* Nothing is set up when an allocation failed, and the run returns straight away. */
+    int set_up = engine_error == SCHED_OK;
+    for (int c = 0; set_up && c < cpus; c++) {
+        memset(&s.cpu[c], 0, sizeof(CpuState));
+        rq_init(&s.cpu[c].rq, &local, p, n, 16);
+        s.cpu[c].rq.order = ranks;
+        s.cpu[c].rq.ranked = ranks != NULL && local.aging <= 0;
+        s.cpu[c].running = -1;
+        s.cpu[c].last_ran = -1;
+        s.cpu[c].slice_end = INT_MAX;
+        s.events[c] = c;
+        s.event_pos[c] = c;
+        s.cpu[c].idle_listed = 1;
+        s.idle[s.idle_count++] = cpus - 1 - c;
+    }
+    for (int i = 0; set_up && i < n; i++)
+        s.last_cpu[i] = -1;
+
+    int next = 0, completed = 0;
+    while (engine_error == SCHED_OK && completed < n) {
+        int now = s.cpu[s.events[0]].slice_end;
+        if (next < n && p[order[next]].arrival < now)
+            now = p[order[next]].arrival;
+
+        /* Same order as simulate(): slices end, arrivals queue, then expired slices requeue. */
+        int expired_count = 0;
+        while (s.cpu[s.events[0]].slice_end == now) {
+            int c = s.events[0];
+            int r = s.cpu[c].running;
+            if (s.cpu[c].switching) {
+                /* Decided in the touched pass, after this instant's arrivals are placed. */
+                s.cpu[c].switching = 0;
+                s.cpu[c].starting = 1;
+                cpu_event_update(&s, c, INT_MAX);
+                cpu_touch(&s, c);
+                continue;
+            }
+            p[r].remaining_bt -= now - s.cpu[c].run_start;
+            if (gantts)
+                gantt_close(&gantts[c], now);
+            cpu_event_update(&s, c, INT_MAX);
+            if (p[r].remaining_bt == 0) {
+                p[r].ct = now;
+                p[r].tat = now - p[r].arrival;
+                p[r].waiting = p[r].tat - p[r].burst;
+                completed++;
+                s.cpu[c].running = -1;
+                if (s.cpu[c].rq.count == 0 && !s.cpu[c].idle_listed) {
+                    s.cpu[c].idle_listed = 1;
+                    s.idle[s.idle_count++] = c;
+                }
+            } else {
+                expired[expired_count++] = c;
+            }
+            cpu_touch(&s, c);
+        }
+
+        while (next < n && p[order[next]].arrival == now) {
+            int idx = order[next++];
+            cpu_enqueue(&s, place_process(&s, idx), idx, now);
+        }
+
+        for (int e = 0; e < expired_count; e++) {
+            int c = expired[e];
+            int r = s.cpu[c].running;
+            s.cpu[c].running = -1;
+            cpu_enqueue(&s, c, r, now);
+        }
+
+        for (int t = 0; t < s.touched_count; t++) {
+            int c = s.touched[t];
+            CpuState *cpu = &s.cpu[c];
+            cpu->touched = 0;
+            if (cpu->running == -1) {
+                int idx = cpu_dequeue(&s, c);
+                if (idx != -1) {
+                    cpu_dispatch(&s, c, idx, now);
+                } else if (!cpu->idle_listed) {
+                    cpu->idle_listed = 1;
+                    s.idle[s.idle_count++] = c;
+                }
+            } else if (cpu->starting) {
+                int r = cpu->running;
+                cpu->starting = 0;
+                if (local.preemptive && cpu->rq.count > 0 && rq_preempts(&cpu->rq, r, now)) {
+                    cpu->running = -1;
+                    rq_push_at(&cpu->rq, r, now);
+                    if (p[r].cpu < 0)
+                        s.stealable++;
+                    cpu_dispatch(&s, c, cpu_dequeue(&s, c), now);
+                } else {
+                    cpu_start(&s, c, now);
+                }
+            } else if (local.preemptive && cpu->rq.count > 0 && !cpu->switching) {
+                int r = cpu->running;
+                p[r].remaining_bt -= now - cpu->run_start;
+                cpu->run_start = now;
+                /* Ties keep the running process, as on one CPU. */
+                if (rq_preempts(&cpu->rq, r, now)) {
+                    if (gantts)
+                        gantt_close(&gantts[c], now);
+                    cpu->running = -1;
+                    rq_push_at(&cpu->rq, r, now);
+                    if (p[r].cpu < 0)
+                        s.stealable++;
+                    cpu_dispatch(&s, c, cpu_dequeue(&s, c), now);
+                } else {
+                    int slice = p[r].remaining_bt;
+                    if (local.quantum > 0 && slice > local.quantum)
+                        slice = local.quantum;
+                    cpu_event_update(&s, c, now + slice);
+                }
+            }
+        }
+        s.touched_count = 0;
+
+        /*
+         * Stealing waits until every CPU has served its own queue, so work
+         * placed at this instant is not pulled away from an idle target.
+         */
+        while (s.stealable > 0 && s.idle_count > 0) {
+            int c = s.idle[--s.idle_count];
+            s.cpu[c].idle_listed = 0;
+            if (s.cpu[c].running != -1)
+                continue;
+            int idx = steal_process(&s, c);
+            if (idx == -1) {
+                s.cpu[c].idle_listed = 1;
+                s.idle[s.idle_count++] = c;
+                break;
+            }
+            cpu_dispatch(&s, c, idx, now);
+        }
+    }
+
+    for (int c = 0; set_up && c < cpus; c++)
+        rq_free(&s.cpu[c].rq);
+    engine_free(order);
+    engine_free(expired);
+    engine_free(s.cpu);
+    engine_free(s.events);
+    engine_free(s.event_pos);
+    engine_free(s.idle);
+    engine_free(s.touched);
+    engine_free(s.last_cpu);
+    engine_free(ranks);
+    return engine_error;
+}
+
+/* Averages of a finished run and the span from the first arrival to the last completion. */
+static void summarize(const Process p[], int n, SchedResult *result) {
+    double total_wt = 0, total_tat = 0, total_rt = 0;
+    memset(result, 0, sizeof(*result));
+    result->first_arrival = INT_MAX;
+    for (int i = 0; i < n; i++) {
+        total_wt += p[i].waiting;
+        total_tat += p[i].tat;
+        total_rt += p[i].rt;
+        if (p[i].arrival < result->first_arrival)
+            result->first_arrival = p[i].arrival;
+        if (p[i].ct > result->last_completion)
+            result->last_completion = p[i].ct;
+    }
+    result->avg_waiting = total_wt / n;
+    result->avg_turnaround = total_tat / n;
+    result->avg_response = total_rt / n;
+}
+
+/* Average waiting and turnaround time into results[0] and results[1], as every scheduler reports them. */
+void average_times(const Process p[], int n, float results[]) {
+    SchedResult summary;
+    summarize(p, n, &summary);
+    results[0] = summary.avg_waiting;
+    results[1] = summary.avg_turnaround;
+}
+
+/* FCFS lists its table in arrival order, ties in input order, as it always has. */
+SchedStatus sort_by_arrival(Process processes[], int n) {
+    int *order = arrival_order(processes, n);
+    Process *sorted = engine_alloc(n * sizeof(Process));
+    if (order == NULL || sorted == NULL) {
+        engine_free(order);
+        engine_free(sorted);
+        return SCHED_ERR_MEMORY;
+    }
+
+    for (int i = 0; i < n; i++)
+        sorted[i] = processes[order[i]];
+    memcpy(processes, sorted, n * sizeof(Process));
+    engine_free(sorted);
+    engine_free(order);
+    return SCHED_OK;
+}
+
+/* Runs algo on the engine with free dispatches and no I/O. */
+static SchedStatus run_engine(Algorithm algo, int quantum, int aging, Process processes[], int n, float results[],
+                              GanttLog *gantt) {
+    SchedConfig config = { algo, quantum, aging, NULL, NULL, NULL, NULL, NULL };
+    SchedPolicy policy = sched_policy(&config);
+    SchedStatus status = simulate(processes, n, &policy, gantt);
+    average_times(processes, n, results);
+    return status;
+}
+
+static SchedStatus fcfs(Process processes[], int n, float results[], GanttLog *gantt) {
+    SchedStatus status = sort_by_arrival(processes, n);
+    if (status != SCHED_OK)
+        return status;
+    return run_engine(ALGO_FCFS, 0, 0, processes, n, results, gantt);
+}
+
+static SchedStatus sjf_non_preemptive(Process processes[], int n, float results[], GanttLog *gantt) {
+    return run_engine(ALGO_SJF, 0, 0, processes, n, results, gantt);
+}
+
+static SchedStatus sjf_preemptive(Process processes[], int n, float results[], GanttLog *gantt) {
+    return run_engine(ALGO_SRTF, 0, 0, processes, n, results, gantt);
+}
+
+static SchedStatus rr(Process processes[], int n, float results[], GanttLog *gantt, int quantum) {
+    return run_engine(ALGO_RR, quantum, 0, processes, n, results, gantt);
+}
+
+static SchedStatus priority_non_preemptive(Process processes[], int n, float results[], GanttLog *gantt, int aging) {
+    return run_engine(ALGO_PRIORITY, 0, aging, processes, n, results, gantt);
+}
+
+static SchedStatus priority_preemptive(Process processes[], int n, float results[], GanttLog *gantt, int aging) {
+    return run_engine(ALGO_PRIORITY_PREEMPTIVE, 0, aging, processes, n, results, gantt);
+}
+
+/*
+ * Multilevel feedback queue: new processes start in the top level, a process
+ * that uses up its level's quantum drops one level, a higher level always
+ * preempts a lower one, and every boost_period everything returns to the
+ * top. A preempted process keeps the time it already used at its level.
+ */
+static SchedStatus mlfq(Process processes[], int n, float results[], GanttLog *gantt, const MlfqConfig *config) {
+    Process *p = processes;
+    int levels = config->levels;
+    SchedPolicy fifo = { NULL, 0, 0, RQ_FIFO, 0, NULL, NULL };
+    ReadyQueue queues[MLFQ_MAX_LEVELS];
+    engine_error = SCHED_OK;
+    int *level = engine_alloc(n * sizeof(int));
+    int *used = engine_alloc(n * sizeof(int));
+    int *order = arrival_order(p, n);
+    if (engine_error != SCHED_OK) {
+        engine_free(level);
+        engine_free(used);
+        engine_free(order);
+        return engine_error;
+    }
+
+    for (int l = 0; l < levels; l++)
+        rq_init(&queues[l], &fifo, p, n, 16);
+
+    int next = 0, completed = 0, running = -1, requeue = -1, slice_end = 0;
+    int now = p[order[0]].arrival;
+    long long next_boost = config->boost_period > 0 ? (now / config->boost_period + 1) * (long long)config->boost_period : LLONG_MAX;
+
+    while (completed < n) {
+        while (next < n && p[order[next]].arrival <= now) {
+            int i = order[next++];
+            level[i] = used[i] = 0;
+            rq_push(&queues[0], i);
+        }
+        /* Arrivals at the end of a slice queue ahead of it, as in rr(). */
+        if (requeue != -1) {
+            rq_push(&queues[level[requeue]], requeue);
+            requeue = -1;
+        }
+        if (now >= next_boost) {
+            for (int l = 1; l < levels; l++) {
+                int i;
+                while ((i = rq_pop(&queues[l])) != -1) {
+                    level[i] = used[i] = 0;
+                    rq_push(&queues[0], i);
+                }
+            }
+            if (running != -1) {
+                level[running] = used[running] = 0;
+                slice_end = now + (p[running].remaining_bt < config->quanta[0] ? p[running].remaining_bt : config->quanta[0]);
+            }
+            next_boost = (now / config->boost_period + 1) * (long long)config->boost_period;
+        }
+        /* A process a full queue could not take is lost, so stop before looking for work. */
+        if (engine_error != SCHED_OK)
+            break;
+
+        int top = 0;
+        while (top < levels && queues[top].count == 0)
+            top++;
+        if (running != -1 && top < level[running]) {
+            gantt_close(gantt, now);
+            rq_push(&queues[level[running]], running);
+            running = -1;
+        }
+        if (running == -1) {
+            if (top == levels) {
+                now = p[order[next]].arrival;
+                continue;
+            }
+            running = rq_pop(&queues[top]);
+            gantt_open(gantt, p[running].id, now);
+            if (p[running].rt < 0)
+                p[running].rt = now - p[running].arrival;
+            int slice = config->quanta[level[running]] - used[running];
+            slice_end = now + (p[running].remaining_bt < slice ? p[running].remaining_bt : slice);
+        }
+
+        long long event = slice_end;
+        if (next < n && p[order[next]].arrival < event)
+            event = p[order[next]].arrival;
+        if (next_boost < event)
+            event = next_boost;
+        p[running].remaining_bt -= event - now;
+        used[running] += event - now;
+        now = (int)event;
+        if (now < slice_end)
+            continue;
+
+        gantt_close(gantt, now);
+        if (p[running].remaining_bt == 0) {
+            p[running].ct = now;
+            p[running].tat = now - p[running].arrival;
+            p[running].waiting = p[running].tat - p[running].burst;
+            completed++;
+        } else {
+            if (level[running] < levels - 1)
+                level[running]++;
+            used[running] = 0;
+            requeue = running;
+        }
+        running = -1;
+    }
+
+    for (int l = 0; l < levels; l++)
+        rq_free(&queues[l]);
+    engine_free(level);
+    engine_free(used);
+    engine_free(order);
+    average_times(p, n, results);
+    return engine_error;
+}
+
+/* Linux load weights for nice 0..19; priority p runs with the weight of nice p. */
+static const int cfs_weights[20] = {
+    1024, 820, 655, 526, 423, 335, 272, 215, 172, 137,
+    110, 87, 70, 56, 45, 36, 29, 23, 18, 15
+};
+
+static int cfs_weight(const Process *p) {
+    return cfs_weights[p->priority < 19 ? p->priority : 19];
+}
+
+/*
+ * Completely-fair-style scheduling. Each process accrues virtual runtime at
+ * CFS_NICE_0_WEIGHT / weight times real time and the one with the least runs
+ * next, taken from a d-ary heap keyed on vruntime. Slices split
+ * CFS_TARGET_LATENCY between the runnable processes by weight, but never go
+ * below CFS_MIN_GRANULARITY. Arrivals start at the queue's minimum vruntime
+ * and preempt once they trail the running process by more than
+ * CFS_WAKEUP_GRANULARITY.
+ */
+static SchedStatus cfs(Process processes[], int n, float results[], GanttLog *gantt) {
+    Process *p = processes;
+    SchedPolicy policy = { priority_key, 0, 1, RQ_DARY_HEAP, 0, NULL, NULL };
+    engine_error = SCHED_OK;
+    long long *vruntime = engine_alloc(n * sizeof(long long));
+    int *order = arrival_order(p, n);
+    if (engine_error != SCHED_OK) {
+        engine_free(vruntime);
+        engine_free(order);
+        return engine_error;
+    }
+    ReadyQueue rq;
+
+    rq_init(&rq, &policy, p, n, n);
+    rq.order = vruntime;
+
+    long long min_vruntime = 0, total_weight = 0;
+    int next = 0, completed = 0, running = -1, slice_end = 0;
+    int now = p[order[0]].arrival;
+
+    while (completed < n) {
+        while (next < n && p[order[next]].arrival <= now) {
+            int i = order[next++];
+            vruntime[i] = min_vruntime;
+            total_weight += cfs_weight(&p[i]);
+            rq_push(&rq, i);
+        }
+        /* A process a full queue could not take is lost, so stop before looking for work. */
+        if (engine_error != SCHED_OK)
+            break;
+
+        if (running != -1 && rq.count > 0 &&
+            vruntime[running] - vruntime[rq_peek(&rq)] > (long long)CFS_WAKEUP_GRANULARITY * CFS_NICE_0_WEIGHT) {
+            gantt_close(gantt, now);
+            rq_push(&rq, running);
+            running = -1;
+        }
+        if (running == -1) {
+            running = rq_pop(&rq);
+            if (running == -1) {
+                now = p[order[next]].arrival;
+                continue;
+            }
+            gantt_open(gantt, p[running].id, now);
+            if (p[running].rt < 0)
+                p[running].rt = now - p[running].arrival;
+
+            long long runnable = rq.count + 1;
+            long long period = CFS_TARGET_LATENCY;
+            if (runnable * CFS_MIN_GRANULARITY > period)
+                period = runnable * CFS_MIN_GRANULARITY;
+            long long slice = period * cfs_weight(&p[running]) / total_weight;
+            if (slice < 1)
+                slice = 1;
+            if (slice > p[running].remaining_bt)
+                slice = p[running].remaining_bt;
+            slice_end = now + (int)slice;
+        }
+
+        int event = slice_end;
+        if (next < n && p[order[next]].arrival < event)
+            event = p[order[next]].arrival;
+        p[running].remaining_bt -= event - now;
+        vruntime[running] += (long long)(event - now) * CFS_NICE_0_WEIGHT * CFS_NICE_0_WEIGHT / cfs_weight(&p[running]);
+        now = event;
+
+        long long leftmost = vruntime[running];
+        if (rq.count > 0 && vruntime[rq_peek(&rq)] < leftmost)
+            leftmost = vruntime[rq_peek(&rq)];
+        if (leftmost > min_vruntime)
+            min_vruntime = leftmost;
+        if (now < slice_end)
+            continue;
+
+        gantt_close(gantt, now);
+        if (p[running].remaining_bt == 0) {
+            p[running].ct = now;
+            p[running].tat = now - p[running].arrival;
+            p[running].waiting = p[running].tat - p[running].burst;
+            total_weight -= cfs_weight(&p[running]);
+            completed++;
+        } else {
+            rq_push(&rq, running);
+        }
+        running = -1;
+    }
+
+    rq_free(&rq);
+    engine_free(vruntime);
+    engine_free(order);
+    average_times(p, n, results);
+    return engine_error;
+}
+
+/*
+ * Engine policy that behaves like config->algo; the first six algorithms are
+ * all built from it. MLFQ and CFS keep per-process state outside the engine
+ * and have no entry.
+ */
+SchedPolicy sched_policy(const SchedConfig *config) {
+    const OverheadModel *overhead = config->overhead;
+    const BurstPlan *bursts = config->bursts;
+    int quantum = config->quantum, aging = config->aging;
+    SchedPolicy policies[ALGO_COUNT] = {
+        { NULL, 0, 0, RQ_FIFO, 0, overhead, bursts },
+        { remaining_key, 0, 0, RQ_DARY_HEAP, 0, overhead, bursts },
+        { remaining_key, 0, 1, RQ_DARY_HEAP, 0, overhead, bursts },
+        { NULL, quantum, 0, RQ_FIFO, 0, overhead, bursts },
+        { priority_key, 0, 0, RQ_BUCKET_QUEUE, aging, overhead, bursts },
+        { priority_key, 0, 1, RQ_BUCKET_QUEUE, aging, overhead, bursts }
+    };
+    return policies[config->algo < ALGO_MLFQ ? config->algo : ALGO_FCFS];
+}
+
+SchedStatus sched_run(const SchedConfig *config, Process processes[], int n, float results[], GanttLog *gantt) {
+    /*
+     * The dedicated loops dispatch for free, run each process in one burst
+     * and start at time zero; the engine models all three and checkpoints.
+     */
+    SchedPolicy policy = sched_policy(config);
+    if (config->algo < ALGO_MLFQ && (policy.overhead != NULL || policy.bursts != NULL ||
+                                     config->checkpoints != NULL || config->resume != NULL)) {
+        SchedStatus status = simulate_checkpointed(processes, n, &policy, gantt, config->checkpoints, config->resume);
+        /*
+         * Sorted only afterwards: burst plans and checkpoints refer to
+         * processes by their place in the trace.
+         */
+        if (status == SCHED_OK && config->algo == ALGO_FCFS)
+            status = sort_by_arrival(processes, n);
+        average_times(processes, n, results);
+        return status;
+    }
+
+    switch (config->algo) {
+        case ALGO_FCFS:
+            return fcfs(processes, n, results, gantt);
+        case ALGO_SJF:
+            return sjf_non_preemptive(processes, n, results, gantt);
+        case ALGO_SRTF:
+            return sjf_preemptive(processes, n, results, gantt);
+        case ALGO_RR:
+            return rr(processes, n, results, gantt, config->quantum);
+        case ALGO_PRIORITY:
+            return priority_non_preemptive(processes, n, results, gantt, config->aging);
+        case ALGO_PRIORITY_PREEMPTIVE:
+            return priority_preemptive(processes, n, results, gantt, config->aging);
+        case ALGO_MLFQ:
+            return mlfq(processes, n, results, gantt, config->mlfq);
+        case ALGO_CFS:
+            return cfs(processes, n, results, gantt);
+        default:
+            return SCHED_ERR_CONFIG;
+    }
+}
+
+/* What sched_simulate() can run: checkpoints need the heap, and only the engine does I/O. */
+static int sched_config_ok(const SchedConfig *config, const Process p[], int n) {
+    if (n < 0 || config->algo < 0 || config->algo >= ALGO_COUNT || config->aging < 0 ||
+        config->checkpoints != NULL || config->resume != NULL)
+        return 0;
+    const OverheadModel *o = config->overhead;
+    if (o != NULL && (o->context_switch < 0 || o->dispatch < 0 || o->cache_warmup < 0))
+        return 0;
+    if (config->algo == ALGO_RR && config->quantum <= 0)
+        return 0;
+    if (config->algo == ALGO_MLFQ) {
+        const MlfqConfig *m = config->mlfq;
+        if (m == NULL || m->levels < 1 || m->levels > MLFQ_MAX_LEVELS || m->boost_period < 0)
+            return 0;
+        for (int l = 0; l < m->levels; l++) {
+            if (m->quanta[l] <= 0)
+                return 0;
+        }
+    }
+    if (config->bursts != NULL && (config->algo >= ALGO_MLFQ || config->bursts->first_count <= n ||
+                                   config->bursts->devices > IO_MAX_DEVICES))
+        return 0;
+    for (int i = 0; i < n; i++) {
+        if (p[i].arrival < 0 || p[i].burst <= 0 || p[i].priority < 0)
+            return 0;
+    }
+    /* mlfq and cfs dispatch for free. */
+    SchedPolicy policy = sched_policy(config);
+    if (config->algo >= ALGO_MLFQ)
+        policy.overhead = NULL;
+    return sched_time_fits(&policy, p, n);
+}
+
+/*
+ * Bytes sched_simulate() takes from its arena: the arrival order and the sort
+ * that builds it, a ready queue or MLFQ level with room for every process,
+ * and the per-process state of aging, I/O, MLFQ or CFS.
+ */
+size_t sched_arena_size(const SchedConfig *config, int n) {
+    if (n <= 0)
+        return 0;
+    size_t ints = arena_round(n * sizeof(int)), longs = arena_round(n * sizeof(long long));
+    size_t size = ARENA_ALIGN - 1 + ints + arena_round(n * sizeof(ArrivalSlot));
+    if (config->algo == ALGO_MLFQ)
+        return size + (2 + (config->mlfq != NULL ? config->mlfq->levels : 0)) * ints;
+    if (config->algo == ALGO_CFS)
+        return size + longs + ints;
+
+    SchedPolicy policy = sched_policy(config);
+    size += ints;
+    if (policy.key != NULL)
+        size += longs;
+    if (policy.bursts != NULL) {
+        int devices = policy.bursts->devices;
+        size += 2 * ints + arena_round(devices * sizeof(IoDevice)) + devices * ints;
+    }
+    return size;
+}
+
+/*
+ * Runs config->algo on one CPU without touching the heap, so it can be called
+ * from any number of threads at once. The engine works in arena and logs the
+ * Gantt chart into gantt, which may be NULL; once gantt_capacity segments are
+ * logged, the rest are dropped. Only the id, arrival, burst and priority of
+ * each process are read, and the results are written to the rest of its
+ * fields, in table order. Returns SCHED_ERR_CONFIG or SCHED_ERR_ARENA without
+ * running if the configuration is invalid or the arena has less than
+ * sched_arena_size() bytes left.
+ */
+SchedStatus sched_simulate(const SchedConfig *config, Process p[], int n, SchedArena *arena, GanttEntry gantt[],
+                           int gantt_capacity, SchedResult *result) {
+    memset(result, 0, sizeof(*result));
+    if (!sched_config_ok(config, p, n))
+        return SCHED_ERR_CONFIG;
+    if (arena->used > arena->size || arena->size - arena->used < sched_arena_size(config, n))
+        return SCHED_ERR_ARENA;
+    if (n == 0)
+        return SCHED_OK;
+
+    for (int i = 0; i < n; i++) {
+        p[i].remaining_bt = p[i].burst;
+        p[i].waiting = p[i].tat = p[i].ct = 0;
+        p[i].rt = -1;
+    }
+    GanttLog log = { gantt, 0, gantt != NULL ? gantt_capacity : 0, 0, 0 };
+    GanttLog *logged = gantt != NULL ? &log : NULL;
+    float averages[2];
+    arena->used += -((uintptr_t)arena->base + arena->used) & (ARENA_ALIGN - 1);
+    engine_arena = arena;
+    /* The engine keeps the table in input order, where fcfs() would sort it. */
+    SchedStatus status;
+    if (config->algo < ALGO_MLFQ) {
+        SchedPolicy policy = sched_policy(config);
+        status = simulate(p, n, &policy, logged);
+    } else if (config->algo == ALGO_MLFQ) {
+        status = mlfq(p, n, averages, logged, config->mlfq);
+    } else {
+        status = cfs(p, n, averages, logged);
+    }
+    engine_arena = NULL;
+
+    summarize(p, n, result);
+    result->gantt_count = log.count;
+    result->gantt_truncated = log.truncated;
+    return status;
+}
+
+const char *sched_strerror(SchedStatus status) {
+    switch (status) {
+        case SCHED_OK:
+            return "Finished.";
+        case SCHED_STOPPED:
+            return "Stopped at the cost budget.";
+        case SCHED_ERR_CONFIG:
+            return "Invalid configuration or process.";
+        case SCHED_ERR_ARENA:
+            return "The arena is smaller than sched_arena_size().";
+        case SCHED_ERR_MEMORY:
+            return "Out of memory while running the simulation.";
+        case SCHED_ERR_STREAM:
+            return "The arrival stream failed.";
+        default:
+            return "Unknown status.";
+    }
+}
+
+/* splitmix64: small state, good enough for workload synthesis, and independent streams from any seed. */
+unsigned long long rng_next(Rng *rng) {
+    unsigned long long z = (rng->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Fixed RM priority of each task, 0 = highest: shorter periods first, ties in task order. */
+static int *rm_ranks(const RtTask tasks[], int n) {
+    ArrivalSlot *by_period = engine_alloc(n * sizeof(ArrivalSlot));
+    int *rank = engine_alloc(n * sizeof(int));
+    if (by_period == NULL || rank == NULL) {
+        engine_free(by_period);
+        engine_free(rank);
+        return NULL;
+    }
+    for (int t = 0; t < n; t++) {
+        by_period[t].arrival = tasks[t].period;
+        by_period[t].idx = t;
+    }
+    qsort(by_period, n, sizeof(ArrivalSlot), compare_arrival);
+    for (int r = 0; r < n; r++)
+        rank[by_period[r].idx] = r;
+    engine_free(by_period);
+    return rank;
+}
+
+/*
+ * Preemptive EDF or RM on one CPU over the jobs released before horizon.
+ * Each task keeps only its next release, in a heap, and a job exists from
+ * its release until it completes, in a recycled slot of the ready queue, so
+ * a run costs O(log n) per release, preemption and completion however long
+ * the hyperperiod is. The queue's order array holds each job's absolute
+ * deadline (EDF) or RM rank and release (RM); ties go to the higher RM
+ * priority. Jobs that miss their deadline still run to completion.
+ */
+SchedStatus simulate_realtime(const RtTask tasks[], int n, RtPolicy policy, int horizon, unsigned long long seed,
+                              GanttLog *gantt, RtStats *st) {
+    engine_error = SCHED_OK;
+    int *rank = rm_ranks(tasks, n);
+    Rng rng = { seed };
+
+    Process *releases = engine_alloc(n * sizeof(Process));
+    if (rank == NULL || releases == NULL) {
+        engine_free(rank);
+        engine_free(releases);
+        return SCHED_ERR_MEMORY;
+    }
+    SchedPolicy by_release = { arrival_key, 0, 0, RQ_DARY_HEAP, 0, NULL, NULL };
+    ReadyQueue pending;
+    rq_init(&pending, &by_release, releases, n, n);
+    memset(releases, 0, n * sizeof(Process));
+    for (int t = 0; t < n; t++) {
+        releases[t].id = tasks[t].id;
+        releases[t].arrival = tasks[t].phase;
+        if (tasks[t].phase < horizon)
+            rq_push(&pending, t);
+    }
+
+    SchedPolicy by_deadline = { priority_key, 0, 1, RQ_DARY_HEAP, 0, NULL, NULL };
+    Process *jobs = NULL;
+    int *owner = NULL, *free_slots = NULL;
+    int capacity = 0, free_count = 0, in_flight = 0, running = -1;
+    ReadyQueue ready;
+    rq_init(&ready, &by_deadline, NULL, 0, 16);
+
+    int now = pending.count > 0 ? releases[rq_peek(&pending)].arrival : 0;
+    st->first_release = now;
+    while (engine_error == SCHED_OK) {
+        while (pending.count > 0 && releases[rq_peek(&pending)].arrival <= now) {
+            int t = rq_pop(&pending);
+            if (free_count == 0) {
+                int old_capacity = capacity, grown_capacity = capacity;
+                Process *grown = reserve_processes(jobs, &grown_capacity, capacity ? capacity * 2 : 64);
+                int *grown_owner = realloc(owner, grown_capacity * sizeof(int));
+                int *grown_free = realloc(free_slots, grown_capacity * sizeof(int));
+                long long *grown_order = realloc(ready.order, grown_capacity * sizeof(long long));
+                if (grown != NULL)
+                    jobs = grown;
+                if (grown_owner != NULL)
+                    owner = grown_owner;
+                if (grown_free != NULL)
+                    free_slots = grown_free;
+                if (grown_order != NULL)
+                    ready.order = grown_order;
+                if (grown == NULL || grown_owner == NULL || grown_free == NULL || grown_order == NULL) {
+                    engine_error = SCHED_ERR_MEMORY;
+                    break;
+                }
+                capacity = grown_capacity;
+                for (int i = capacity - 1; i >= old_capacity; i--)
+                    free_slots[free_count++] = i;
+                ready.procs = jobs;
+            }
+            int slot = free_slots[--free_count];
+            int release = releases[t].arrival;
+            Process job = { tasks[t].id, release, tasks[t].wcet, rank[t], tasks[t].wcet, 0, 0, 0, -1, -1 };
+            jobs[slot] = job;
+            owner[slot] = t;
+            if (policy == RT_EDF)
+                ready.order[slot] = (long long)release + tasks[t].deadline;
+            else
+                ready.order[slot] = ((long long)rank[t] << 32) + release;
+            rq_push(&ready, slot);
+            if (++in_flight > st->peak_pending)
+                st->peak_pending = in_flight;
+
+            long long next = (long long)release + tasks[t].period;
+            if (tasks[t].jitter > 0)
+                next += rng_next(&rng) % ((unsigned long long)tasks[t].jitter + 1);
+            if (next < horizon) {
+                releases[t].arrival = (int)next;
+                rq_push(&pending, t);
+            }
+        }
+        if (engine_error != SCHED_OK)
+            break;
+
+        /* Ties keep the running job. */
+        if (running != -1 && ready.count > 0 && rq_preempts(&ready, running, now)) {
+            gantt_close(gantt, now);
+            rq_push(&ready, running);
+            running = -1;
+            st->preemptions++;
+        }
+        if (running == -1) {
+            running = rq_pop(&ready);
+            if (running == -1) {
+                if (pending.count == 0)
+                    break;
+                now = releases[rq_peek(&pending)].arrival;
+                continue;
+            }
+            gantt_open(gantt, jobs[running].id, now);
+            if (jobs[running].rt < 0)
+                jobs[running].rt = now - jobs[running].arrival;
+        }
+
+        int next_release = pending.count > 0 ? releases[rq_peek(&pending)].arrival : INT_MAX;
+        int done = now + jobs[running].remaining_bt;
+        if (next_release < done) {
+            jobs[running].remaining_bt -= next_release - now;
+            now = next_release;
+            continue;
+        }
+
+        now = done;
+        gantt_close(gantt, now);
+        const RtTask *task = &tasks[owner[running]];
+        RtTaskStats *ts = &st->tasks[owner[running]];
+        long long lateness = (long long)now - jobs[running].arrival - task->deadline;
+        int response = now - jobs[running].arrival;
+        if (ts->jobs == 0 || lateness > ts->max_lateness)
+            ts->max_lateness = lateness;
+        if (lateness > 0) {
+            ts->missed++;
+            st->missed++;
+            st->tardiness += lateness;
+        }
+        ts->jobs++;
+        ts->total_response += response;
+        if (response > ts->max_response)
+            ts->max_response = response;
+        st->jobs++;
+        st->busy += task->wcet;
+        free_slots[free_count++] = running;
+        in_flight--;
+        running = -1;
+    }
+    st->finished = now;
+
+    rq_free(&pending);
+    rq_free(&ready);
+    free(ready.order);
+    engine_free(releases);
+    free(jobs);
+    free(owner);
+    free(free_slots);
+    engine_free(rank);
+    return engine_error;
+}
@@ -0,0 +1,140 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+/*
+ * Scheduling engine of the simulator, without any of its input or output.
+ * sched_simulate() runs one algorithm on a process table inside memory the
+ * caller provides, and is the entry point for other programs. The simulator
+ * itself also uses the engines declared in scheduler_internal.h.
+ */
+
+#include <stddef.h>
+#include <limits.h>
+
+typedef struct {
+    int id;
+    int arrival;
+    int burst;
+    int priority;
+    int remaining_bt;
+    int waiting;
+    int tat;
+    int ct; 
+    int rt;     /* response time, -1 until first dispatched */
+    int cpu;    /* CPU the process is pinned to, -1 = any */
+} Process;
+
+typedef struct {
+    int process_id;
+    int start_time;
+    int end_time;
+} GanttEntry;
+
+/* CPU time charged before a dispatched process starts running. */
+typedef struct {
+    int context_switch;     /* the CPU ran a different process before */
+    int dispatch;           /* every dispatch, including resuming the same process */
+    int cache_warmup;       /* the process was not the last one on this CPU */
+} OverheadModel;
+
+/* Gantt segments with this id are overhead rather than a process. */
+#define GANTT_OVERHEAD_ID INT_MIN
+
+#define IO_MAX_DEVICES 64
+
+/* One step of a burst sequence: io time units on device, then a CPU burst. */
+typedef struct {
+    int io;             /* 0 for the first step, which starts on the CPU */
+    int device;
+    int cpu;
+} BurstStep;
+
+/*
+ * CPU/I-O burst sequences of a trace whose burst fields read
+ * "cpu/io[@device]/cpu...". Process i owns steps[first[i]] up to
+ * steps[first[i + 1] - 1]; one without steps runs its burst in one go.
+ * Process.burst holds the total CPU time either way.
+ */
+typedef struct {
+    int *first;         /* NULL when no process does I/O */
+    int first_count;
+    int first_capacity;
+    BurstStep *steps;
+    int step_count;
+    int step_capacity;
+    int devices;        /* highest device used + 1 */
+} BurstPlan;
+
+#define MLFQ_MAX_LEVELS 16
+
+typedef struct {
+    int levels;
+    int quanta[MLFQ_MAX_LEVELS];    /* time slice per level, top level first */
+    int boost_period;               /* return everything to the top level this often, 0 = never */
+} MlfqConfig;
+
+typedef enum {
+    ALGO_FCFS,
+    ALGO_SJF,
+    ALGO_SRTF,
+    ALGO_RR,
+    ALGO_PRIORITY,
+    ALGO_PRIORITY_PREEMPTIVE,
+    ALGO_MLFQ,
+    ALGO_CFS,
+    ALGO_COUNT
+} Algorithm;
+
+/* Checkpointing state, only used by the simulator itself; see scheduler_internal.h. */
+typedef struct CheckpointLog CheckpointLog;
+typedef struct ResumePoint ResumePoint;
+
+/*
+ * Everything a run depends on besides the process table. Each run reads only
+ * its own config, so any number can go at once on different threads.
+ */
+typedef struct {
+    Algorithm algo;
+    int quantum;                    /* ALGO_RR */
+    int aging;                      /* ALGO_PRIORITY and ALGO_PRIORITY_PREEMPTIVE, 0 = off */
+    const MlfqConfig *mlfq;         /* ALGO_MLFQ */
+    const OverheadModel *overhead;  /* NULL = dispatching is free */
+    const BurstPlan *bursts;        /* NULL = one CPU burst per process */
+    CheckpointLog *checkpoints;     /* NULL = take none */
+    const ResumePoint *resume;      /* NULL = start at the first arrival */
+} SchedConfig;
+
+/* Outcome of a run; the library reports errors instead of printing them or exiting. */
+typedef enum {
+    SCHED_OK,
+    SCHED_STOPPED,          /* the cost budget ran out before every process finished */
+    SCHED_ERR_CONFIG,       /* invalid configuration, process or stream arrival */
+    SCHED_ERR_ARENA,        /* the arena has less than sched_arena_size() bytes left */
+    SCHED_ERR_MEMORY,       /* an allocation failed */
+    SCHED_ERR_STREAM        /* the stream's next() reported an error */
+} SchedStatus;
+
+/* Caller-owned memory that sched_simulate() works in instead of the heap. */
+typedef struct {
+    void *base;
+    size_t size;
+    size_t used;        /* bytes taken so far; set it back to 0 to reuse the arena */
+} SchedArena;
+
+/* Summary of a sched_simulate() run; the per-process results are in the process table. */
+typedef struct {
+    double avg_waiting;
+    double avg_turnaround;
+    double avg_response;
+    int first_arrival;
+    int last_completion;
+    int gantt_count;        /* segments written to the Gantt buffer */
+    int gantt_truncated;    /* the buffer filled up; the metrics still cover the whole run */
+} SchedResult;
+
+size_t sched_arena_size(const SchedConfig *config, int n);
+SchedStatus sched_simulate(const SchedConfig *config, Process p[], int n, SchedArena *arena, GanttEntry gantt[],
+                           int gantt_capacity, SchedResult *result);
+const char *sched_strerror(SchedStatus status);
+
+#endif
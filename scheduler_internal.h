@@ -0,0 +1,318 @@
+#ifndef SCHEDULER_INTERNAL_H
+#define SCHEDULER_INTERNAL_H
+
+/*
+ * The rest of the engine, for the simulator: heap-backed runs with growing
+ * Gantt logs, checkpoints, streams, multi-CPU and real-time runs, and the
+ * self-profile. Other programs should only need scheduler.h.
+ */
+
+#include "scheduler.h"
+
+/*
+ * Self-profiling, compiled in with -DSCHED_PROFILE. Each thread counts into
+ * its own Profile and adds it to the shared total when it finishes; the
+ * report goes to stderr at exit. Reading the clock costs about as much as
+ * an engine event, so the per-event phases are only timed on sampled
+ * events: every one of a run's first PROFILE_SAMPLE_EVERY events, then one
+ * in PROFILE_SAMPLE_EVERY, weighted by the events each stands for. Timing
+ * a phase on its own inflates it, so the report takes off what the probes
+ * themselves cost and splits the rest of the engine's time by each phase's
+ * share of the sampled events' time. The event counters are exact; the
+ * engine keeps them per run and adds them to the thread's Profile when the
+ * run ends. Without the flag the hooks expand to the bare statement or to
+ * nothing. The profile lives in the program, so scheduler.c only takes the
+ * flag when it is built into the simulator.
+ */
+#ifdef SCHED_PROFILE
+#include <time.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define PROFILE_UNIT_TSC 1
+#define PROFILE_UNIT "TSC ticks"
+#else
+#define PROFILE_UNIT "ns"
+#endif
+
+typedef enum {
+    PHASE_INPUT,
+    PHASE_ENGINE,       /* whole engine run, including the four below */
+    PHASE_SORT,
+    PHASE_ADMIT,
+    PHASE_SELECT,
+    PHASE_GANTT,
+    PHASE_OUTPUT,
+    PHASE_SAMPLED,      /* sampled events from start to end, which the engine phases are shares of */
+    PHASE_COUNT
+} ProfilePhase;
+
+/* Each engine path bumps at most one of these; dispatches and admit scans are derived in the report. */
+typedef enum {
+    COUNT_RUNS,
+    COUNT_EVENTS,
+    COUNT_IDLE_JUMPS,
+    COUNT_IDLE_SKIPPED,
+    COUNT_PREEMPTIONS,
+    COUNT_SWITCH_PREEMPTIONS,   /* preempted while paying dispatch overhead */
+    COUNT_KEPT,                 /* arrival or wake-up that left the running process on the CPU */
+    COUNT_EXPIRIES,
+    COUNT_IO_BLOCKS,
+    COUNT_CHARGED,              /* dispatches that paid overhead */
+    COUNT_ADMITTED,
+    COUNTER_COUNT
+} ProfileCounter;
+
+#define PROFILE_SAMPLE_EVERY 1024
+
+typedef struct {
+    unsigned long long ticks[PHASE_COUNT];
+    unsigned long long counts[COUNTER_COUNT];
+    unsigned long long probes;          /* phases timed in sampled events, weighted like PHASE_SAMPLED */
+    unsigned long long clock_reads;     /* inside the engine's event loop, all charged to the engine */
+} Profile;
+
+static inline unsigned long long profile_clock(void) {
+#ifdef PROFILE_UNIT_TSC
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/*
+ * One engine run's counters, kept by the engine until the run ends. The
+ * loop only counts down to the next event profile_event() has to look at:
+ * a sampled one, or the one after it, which ends the sample.
+ */
+typedef struct {
+    unsigned long long counts[COUNTER_COUNT];
+    unsigned long long weight;          /* events the current one stands for, 0 = not sampled */
+    unsigned long long event_start;
+    unsigned countdown;
+    unsigned period;                    /* events from the last one profile_event() saw to the next */
+} ProfileRun;
+
+extern __thread Profile profile;
+void profile_init(void);
+void profile_flush(void);
+unsigned long long profile_elapsed(unsigned long long start);
+void profile_event(ProfileRun *run);
+void profile_sample(ProfileRun *run, ProfilePhase phase, unsigned long long start);
+void profile_run_end(ProfileRun *run);
+
+#define PROFILE_TIME(phase, ...) do { \
+        unsigned long long profile_start_ = profile_clock(); \
+        __VA_ARGS__; \
+        profile.ticks[phase] += profile_elapsed(profile_start_); \
+    } while (0)
+#define PROFILE_SAMPLE(phase, ...) do { \
+        if (__builtin_expect(profile_run_.weight != 0, 0)) { \
+            unsigned long long profile_start_ = profile_clock(); \
+            __VA_ARGS__; \
+            profile_sample(&profile_run_, phase, profile_start_); \
+        } else { \
+            __VA_ARGS__; \
+        } \
+    } while (0)
+#define PROFILE_COUNTERS() ProfileRun profile_run_ = { { 0 }, 0, 0, 1, 1 }
+#define PROFILE_COUNTERS_ADD() profile_run_end(&profile_run_)
+#define PROFILE_EVENT() do { \
+        if (__builtin_expect(--profile_run_.countdown == 0, 0)) \
+            profile_event(&profile_run_); \
+    } while (0)
+#define PROFILE_COUNT(counter, amount) (profile_run_.counts[counter] += (amount))
+#define PROFILE_INIT() profile_init()
+#define PROFILE_FLUSH() profile_flush()
+#else
+#define PROFILE_TIME(phase, ...) __VA_ARGS__
+#define PROFILE_SAMPLE(phase, ...) __VA_ARGS__
+#define PROFILE_COUNTERS()
+#define PROFILE_COUNTERS_ADD() ((void)0)
+#define PROFILE_EVENT() ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)0)
+#define PROFILE_INIT() ((void)0)
+#define PROFILE_FLUSH() ((void)0)
+#endif
+
+/* Segments in time order; contiguous segments of the same process are merged as they are logged. */
+typedef struct {
+    GanttEntry *entries;
+    int count;
+    int capacity;
+    int truncated;      /* a caller's fixed buffer filled up and later segments were dropped */
+    long long decisions;    /* segments opened, merged ones included: one per scheduling decision */
+} GanttLog;
+
+/*
+ * Query index over a Gantt log. Segments are sorted and disjoint, so a
+ * binary search finds the one covering any time, and busy_before[i] holds
+ * the time processes ran before entries[i] (overhead excluded).
+ */
+typedef struct {
+    const GanttLog *log;
+    long long *busy_before;     /* count + 1 prefix sums */
+} Timeline;
+
+typedef enum {
+    RQ_BINARY_HEAP,
+    RQ_DARY_HEAP,       /* HEAP_ARITY children per node */
+    RQ_PAIRING_HEAP,
+    RQ_BUCKET_QUEUE,    /* small non-negative keys, falls back to RQ_DARY_HEAP */
+    RQ_FIFO
+} ReadyQueueKind;
+
+typedef struct {
+    int (*key)(const Process *p);   /* smaller key runs first, NULL = FIFO */
+    int quantum;                    /* 0 = run until completion or preemption */
+    int preemptive;                 /* re-evaluate the running process on every arrival */
+    ReadyQueueKind queue;           /* ready queue used when key is set */
+    int aging;                      /* waiting time that improves the key by one, 0 = no aging */
+    const OverheadModel *overhead;  /* NULL = dispatching is free */
+    const BurstPlan *bursts;        /* NULL = one CPU burst per process */
+} SchedPolicy;
+
+typedef struct {
+    long long migrations;   /* dispatches on a different CPU than the previous one */
+    long long steals;       /* processes pulled from another CPU's queue */
+} SmpStats;
+
+/* Weighted cost of a run, accumulated as processes complete and the CPU switches. */
+typedef struct {
+    double waiting_weight;      /* per unit of waiting time */
+    double tat_weight;          /* per unit of turnaround time */
+    double switch_weight;       /* per context switch */
+    double limit;               /* stop the run once cost exceeds this */
+    double cost;
+    long long switches;
+    int stopped;
+} CostBudget;
+
+/*
+ * Arrival source for simulate_stream(). next() fills in the next process in
+ * arrival order and returns 1, or 0 at the end of the input and -1 after an
+ * error; finished() receives each process as it completes, with its results.
+ */
+typedef struct {
+    int (*next)(void *ctx, Process *p);
+    void (*finished)(void *ctx, const Process *p);
+    void *ctx;
+    int in_flight;
+    int peak_in_flight;
+    long long switches;
+    long long overhead;     /* CPU time charged by the overhead model */
+} SchedStream;
+
+/*
+ * Engine state at the top of an event loop iteration. Processes admitted by
+ * then that have no record had completed; the records hold the ready queue,
+ * in queue order for FIFO queues, then the running process.
+ */
+typedef struct {
+    int time;
+    int next;               /* processes admitted so far, in arrival order */
+    int running;            /* -1 = CPU free */
+    int last_ran;
+    int last_started;
+    int open_start;         /* start of the running process's open Gantt segment */
+    int gantt_count;        /* closed Gantt segments */
+    int active;             /* records of this checkpoint */
+    long long first_record;
+    GanttEntry gantt_last;  /* last closed segment as it was then; a later dispatch may extend it */
+    int reserved;
+} Checkpoint;
+
+typedef struct {
+    int idx;
+    int remaining_bt;
+    int rt;
+    int reserved;
+    long long order;        /* aged queue order, minus the dispatch time for the running process; 0 without aging */
+} CheckpointProcess;
+
+/* Checkpoints of a run, taken at the first event on or after each multiple of every. */
+struct CheckpointLog {
+    Checkpoint *points;
+    int count;
+    int capacity;
+    CheckpointProcess *records;
+    long long record_count;
+    long long record_capacity;
+    int every;
+    long long next_at;
+};
+
+/* A checkpoint to resume from, with the finished run it was taken in. */
+struct ResumePoint {
+    const Checkpoint *point;
+    const CheckpointProcess *records;
+    const Process *base;        /* final results of that run */
+    const GanttEntry *gantt;    /* its Gantt log */
+    int changed_at;             /* first arrival the edited trace differs in, INT_MAX = none */
+};
+
+typedef enum {
+    RT_EDF,     /* earliest absolute deadline first */
+    RT_RM,      /* shortest period first, fixed per task */
+    RT_COUNT
+} RtPolicy;
+
+/* A periodic task, or a sporadic one when jitter > 0. Every job runs for wcet. */
+typedef struct {
+    int id;
+    int period;         /* separation of releases, the minimum one for sporadic tasks */
+    int wcet;
+    int deadline;       /* relative to the release */
+    int phase;          /* first release */
+    int jitter;         /* sporadic releases come up to this much later than one period apart */
+} RtTask;
+
+typedef struct {
+    long long jobs;
+    long long missed;
+    long long max_lateness;     /* completion minus absolute deadline, negative if every job was early */
+    long long total_response;
+    int max_response;
+} RtTaskStats;
+
+typedef struct {
+    RtTaskStats *tasks;         /* one per task, zeroed by the caller */
+    long long jobs;
+    long long missed;
+    long long tardiness;        /* summed lateness of the jobs that missed */
+    long long preemptions;
+    long long busy;
+    int first_release;
+    int finished;
+    int peak_pending;           /* most jobs released and not yet finished */
+} RtStats;
+
+typedef struct {
+    unsigned long long state;
+} Rng;
+
+SchedPolicy sched_policy(const SchedConfig *config);
+int sched_time_fits(const SchedPolicy *policy, const Process p[], int n);
+SchedStatus sched_run(const SchedConfig *config, Process processes[], int n, float results[], GanttLog *gantt);
+void average_times(const Process p[], int n, float results[]);
+SchedStatus sort_by_arrival(Process processes[], int n);
+SchedStatus simulate_budgeted(Process p[], int n, const SchedPolicy *policy, GanttLog *gantt, CostBudget *budget);
+SchedStatus simulate_stream(SchedStream *stream, const SchedPolicy *policy);
+void checkpoint_log_init(CheckpointLog *log, int every);
+void checkpoint_log_free(CheckpointLog *log);
+SchedStatus checkpoint_log_append(CheckpointLog *log, const Checkpoint points[], int count,
+                                  const CheckpointProcess records[]);
+SchedStatus simulate_smp(Process p[], int n, const SchedPolicy *policy, int cpus, GanttLog gantts[], SmpStats *stats);
+void gantt_reset(GanttLog *gantt);
+void gantt_free(GanttLog *gantt);
+SchedStatus timeline_build(Timeline *tl, const GanttLog *log);
+void timeline_free(Timeline *tl);
+const GanttEntry *timeline_at(const Timeline *tl, int time);
+long long timeline_busy(const Timeline *tl, int from, int to);
+Process *reserve_processes(Process *table, int *capacity, int n);
+SchedStatus simulate_realtime(const RtTask tasks[], int n, RtPolicy policy, int horizon, unsigned long long seed,
+                              GanttLog *gantt, RtStats *st);
+unsigned long long rng_next(Rng *rng);
+
+#endif
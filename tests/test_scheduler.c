@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scheduler.h"
+
+/*
+ * Unit tests of the library: sched_simulate() against schedules worked out
+ * by hand, arena sizing, Gantt truncation and the time limit. Prints each
+ * failure and exits with 1 if there was any.
+ */
+
+#define MAX_PROCS 8
+#define MAX_SEGMENTS 16
+
+typedef struct {
+    const char *name;
+    SchedConfig config;
+    int n;
+    const int (*rows)[4];   /* id, arrival, burst, priority */
+    int segments;
+    GanttEntry gantt[MAX_SEGMENTS];
+    int ct[MAX_PROCS];      /* completion time per process, in table order */
+    int io[MAX_PROCS];      /* time spent on I/O, which is not waiting */
+} ScheduleCase;
+
+static int failures;
+
+static void fail(const char *name, const char *what) {
+    printf("FAIL %s: %s\n", name, what);
+    failures++;
+}
+
+static void load_workload(Process p[], int n, const int rows[][4]) {
+    memset(p, 0, n * sizeof(Process));
+    for (int i = 0; i < n; i++) {
+        p[i].id = rows[i][0];
+        p[i].arrival = rows[i][1];
+        p[i].burst = rows[i][2];
+        p[i].priority = rows[i][3];
+        p[i].cpu = -1;
+    }
+}
+
+/* Runs config in an arena of exactly sched_arena_size() bytes. */
+static SchedStatus run_case(const SchedConfig *config, Process p[], int n, GanttEntry gantt[], int capacity,
+                            SchedResult *result) {
+    size_t size = sched_arena_size(config, n);
+    SchedArena arena = { malloc(size > 0 ? size : 1), size, 0 };
+    SchedStatus status = sched_simulate(config, p, n, &arena, gantt, capacity, result);
+    if (arena.used > arena.size)
+        status = SCHED_ERR_ARENA;
+    free(arena.base);
+    return status;
+}
+
+static void check_schedule(const ScheduleCase *c) {
+    Process p[MAX_PROCS];
+    GanttEntry gantt[MAX_SEGMENTS];
+    SchedResult result;
+    char what[128];
+
+    load_workload(p, c->n, c->rows);
+    if (run_case(&c->config, p, c->n, gantt, MAX_SEGMENTS, &result) != SCHED_OK) {
+        fail(c->name, "run failed");
+        return;
+    }
+    if (result.gantt_count != c->segments || result.gantt_truncated)
+        fail(c->name, "wrong number of Gantt segments");
+    for (int s = 0; s < c->segments && s < result.gantt_count; s++) {
+        const GanttEntry *got = &gantt[s], *want = &c->gantt[s];
+        if (got->process_id != want->process_id || got->start_time != want->start_time ||
+            got->end_time != want->end_time) {
+            snprintf(what, sizeof(what), "segment %d is P%d %d-%d, expected P%d %d-%d", s, got->process_id,
+                     got->start_time, got->end_time, want->process_id, want->start_time, want->end_time);
+            fail(c->name, what);
+        }
+    }
+    for (int i = 0; i < c->n; i++) {
+        if (p[i].ct != c->ct[i] || p[i].tat != p[i].ct - p[i].arrival ||
+            p[i].waiting != p[i].tat - p[i].burst - c->io[i]) {
+            snprintf(what, sizeof(what), "P%d completes at %d, expected %d", p[i].id, p[i].ct, c->ct[i]);
+            fail(c->name, what);
+        }
+    }
+}
+
+/* id, arrival, burst, priority */
+static const int workload[4][4] = {
+    { 1, 0, 5, 2 },
+    { 2, 1, 3, 1 },
+    { 3, 2, 8, 3 },
+    { 4, 3, 6, 0 }
+};
+
+static const int cfs_workload[3][4] = {
+    { 1, 0, 30, 0 },
+    { 2, 2, 4, 0 },
+    { 3, 10, 2, 0 }
+};
+
+/* Without aging, P3 runs before P2 at 6, and P1 runs 0-10 in the preemptive case. */
+static const int aging_workload[4][4] = {
+    { 1, 0, 6, 0 },
+    { 2, 0, 2, 3 },
+    { 3, 5, 2, 1 },
+    { 4, 7, 2, 0 }
+};
+
+static const int preemptive_aging_workload[3][4] = {
+    { 1, 0, 10, 0 },
+    { 2, 1, 3, 2 },
+    { 3, 8, 2, 3 }
+};
+
+static const int overhead_workload[2][4] = {
+    { 1, 0, 5, 0 },
+    { 2, 1, 2, 0 }
+};
+
+/* P1 runs 3, does 2 of I/O on device 0 and runs 2 more. */
+static const int io_workload[3][4] = {
+    { 1, 0, 5, 0 },
+    { 2, 1, 4, 0 },
+    { 3, 2, 1, 0 }
+};
+
+static const MlfqConfig two_levels = { 2, { 2, 4 }, 0 };
+
+static const OverheadModel switch_and_dispatch = { 1, 1, 0 };
+
+static int io_first[] = { 0, 2, 2, 2 };
+static BurstStep io_steps[] = { { 0, 0, 3 }, { 2, 0, 2 } };
+static const BurstPlan io_plan = { io_first, 4, 4, io_steps, 2, 2, 1 };
+
+static void test_schedules(void) {
+    ScheduleCase cases[] = {
+        { "fcfs", { ALGO_FCFS, 0, 0, NULL, NULL, NULL, NULL, NULL }, 4, workload, 4,
+          { { 1, 0, 5 }, { 2, 5, 8 }, { 3, 8, 16 }, { 4, 16, 22 } }, { 5, 8, 16, 22 }, { 0 } },
+        { "sjf", { ALGO_SJF, 0, 0, NULL, NULL, NULL, NULL, NULL }, 4, workload, 4,
+          { { 1, 0, 5 }, { 2, 5, 8 }, { 4, 8, 14 }, { 3, 14, 22 } }, { 5, 8, 22, 14 }, { 0 } },
+        { "srtf", { ALGO_SRTF, 0, 0, NULL, NULL, NULL, NULL, NULL }, 4, workload, 5,
+          { { 1, 0, 1 }, { 2, 1, 4 }, { 1, 4, 8 }, { 4, 8, 14 }, { 3, 14, 22 } }, { 8, 4, 22, 14 }, { 0 } },
+        { "rr", { ALGO_RR, 2, 0, NULL, NULL, NULL, NULL, NULL }, 4, workload, 12,
+          { { 1, 0, 2 }, { 2, 2, 4 }, { 3, 4, 6 }, { 1, 6, 8 }, { 4, 8, 10 }, { 2, 10, 11 },
+            { 3, 11, 13 }, { 1, 13, 14 }, { 4, 14, 16 }, { 3, 16, 18 }, { 4, 18, 20 }, { 3, 20, 22 } },
+          { 14, 11, 22, 20 }, { 0 } },
+        { "priority", { ALGO_PRIORITY, 0, 0, NULL, NULL, NULL, NULL, NULL }, 4, workload, 4,
+          { { 1, 0, 5 }, { 4, 5, 11 }, { 2, 11, 14 }, { 3, 14, 22 } }, { 5, 14, 22, 11 }, { 0 } },
+        { "priority-preemptive", { ALGO_PRIORITY_PREEMPTIVE, 0, 0, NULL, NULL, NULL, NULL, NULL }, 4, workload, 6,
+          { { 1, 0, 1 }, { 2, 1, 3 }, { 4, 3, 9 }, { 2, 9, 10 }, { 1, 10, 14 }, { 3, 14, 22 } },
+          { 14, 10, 22, 9 }, { 0 } },
+        { "mlfq", { ALGO_MLFQ, 0, 0, &two_levels, NULL, NULL, NULL, NULL }, 4, workload, 9,
+          { { 1, 0, 2 }, { 2, 2, 4 }, { 3, 4, 6 }, { 4, 6, 8 }, { 1, 8, 11 }, { 2, 11, 12 },
+            { 3, 12, 16 }, { 4, 16, 20 }, { 3, 20, 22 } },
+          { 11, 12, 22, 20 }, { 0 } },
+        { "cfs", { ALGO_CFS, 0, 0, NULL, NULL, NULL, NULL, NULL }, 3, cfs_workload, 4,
+          { { 1, 0, 10 }, { 2, 10, 14 }, { 3, 14, 16 }, { 1, 16, 36 } }, { 36, 14, 16 }, { 0 } },
+        /* A waiting process's order is priority * aging + arrival: 3 for P2, 6 for P3, 7 for P4. */
+        { "priority aging", { ALGO_PRIORITY, 0, 1, NULL, NULL, NULL, NULL, NULL }, 4, aging_workload, 4,
+          { { 1, 0, 6 }, { 2, 6, 8 }, { 3, 8, 10 }, { 4, 10, 12 } }, { 6, 8, 10, 12 }, { 0 } },
+        /*
+         * When P3 arrives at 8 the orders are 5 for P2, 8 for the running P1 and 14
+         * for P3. P2 takes the CPU, and P1 is requeued at 8, still ahead of P3.
+         */
+        { "priority-preemptive aging", { ALGO_PRIORITY_PREEMPTIVE, 0, 2, NULL, NULL, NULL, NULL, NULL }, 3,
+          preemptive_aging_workload, 4,
+          { { 1, 0, 8 }, { 2, 8, 11 }, { 1, 11, 13 }, { 3, 13, 15 } }, { 13, 11, 15 }, { 0 } },
+        /* Every dispatch costs 1 and a switch 1 more, even when P1 resumes after itself at 11. */
+        { "rr overhead", { ALGO_RR, 2, 0, NULL, &switch_and_dispatch, NULL, NULL, NULL }, 2, overhead_workload, 8,
+          { { GANTT_OVERHEAD_ID, 0, 1 }, { 1, 1, 3 }, { GANTT_OVERHEAD_ID, 3, 5 }, { 2, 5, 7 },
+            { GANTT_OVERHEAD_ID, 7, 9 }, { 1, 9, 11 }, { GANTT_OVERHEAD_ID, 11, 12 }, { 1, 12, 13 } },
+          { 13, 7 }, { 0 } },
+        /* P1 blocks 3-5 and its 2-unit burst then takes the CPU from P2's remaining 3. */
+        { "srtf io", { ALGO_SRTF, 0, 0, NULL, NULL, &io_plan, NULL, NULL }, 3, io_workload, 5,
+          { { 1, 0, 3 }, { 3, 3, 4 }, { 2, 4, 5 }, { 1, 5, 7 }, { 2, 7, 10 } }, { 7, 10, 4 }, { 2, 0, 0 } }
+    };
+    int count = (int)(sizeof(cases) / sizeof(cases[0]));
+
+    for (int c = 0; c < count; c++)
+        check_schedule(&cases[c]);
+}
+
+static void test_arena_size(void) {
+    SchedConfig configs[] = {
+        { ALGO_FCFS, 0, 0, NULL, NULL, NULL, NULL, NULL },
+        { ALGO_SRTF, 0, 0, NULL, NULL, NULL, NULL, NULL },
+        { ALGO_RR, 2, 0, NULL, NULL, NULL, NULL, NULL },
+        { ALGO_PRIORITY, 0, 10, NULL, NULL, NULL, NULL, NULL },
+        { ALGO_MLFQ, 0, 0, &two_levels, NULL, NULL, NULL, NULL },
+        { ALGO_CFS, 0, 0, NULL, NULL, NULL, NULL, NULL }
+    };
+    Process p[4];
+    SchedResult result;
+
+    for (int c = 0; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+        size_t size = sched_arena_size(&configs[c], 4);
+        char *memory = malloc(size);
+        SchedArena arena = { memory, size - 1, 0 };
+
+        load_workload(p, 4, workload);
+        if (sched_simulate(&configs[c], p, 4, &arena, NULL, 0, &result) != SCHED_ERR_ARENA)
+            fail("arena", "a run accepted an arena one byte short");
+        arena.size = size;
+        arena.used = 0;
+        if (sched_simulate(&configs[c], p, 4, &arena, NULL, 0, &result) != SCHED_OK || arena.used > size)
+            fail("arena", "a run did not fit in sched_arena_size() bytes");
+        free(memory);
+    }
+
+    SchedConfig bad = { ALGO_RR, 0, 0, NULL, NULL, NULL, NULL, NULL };
+    if (run_case(&bad, p, 4, NULL, 0, &result) != SCHED_ERR_CONFIG)
+        fail("arena", "rr without a quantum was not rejected");
+    if (sched_arena_size(&configs[0], 0) != 0 || run_case(&configs[0], p, 0, NULL, 0, &result) != SCHED_OK)
+        fail("arena", "an empty table needs no arena");
+}
+
+static void test_gantt_truncation(void) {
+    SchedConfig config = { ALGO_RR, 2, 0, NULL, NULL, NULL, NULL, NULL };
+    Process p[4];
+    GanttEntry gantt[3];
+    SchedResult result;
+
+    load_workload(p, 4, workload);
+    if (run_case(&config, p, 4, gantt, 3, &result) != SCHED_OK) {
+        fail("truncation", "run failed");
+        return;
+    }
+    if (result.gantt_count != 3 || !result.gantt_truncated)
+        fail("truncation", "the log did not stop at the buffer size");
+    if (gantt[2].process_id != 3 || gantt[2].start_time != 4 || gantt[2].end_time != 6)
+        fail("truncation", "the kept segments changed");
+    /* The metrics still cover the whole run: waiting times 9, 7, 12 and 11. */
+    if (result.avg_waiting != 9.75 || result.last_completion != 22)
+        fail("truncation", "the metrics stopped with the log");
+}
+
+static void test_time_limit(void) {
+    SchedConfig config = { ALGO_FCFS, 0, 0, NULL, NULL, NULL, NULL, NULL };
+    static const int too_long[2][4] = { { 1, 0, 2000000000, 1 }, { 2, 0, 2000000000, 1 } };
+    static const int just_fits[2][4] = { { 1, 0, 1073741823, 0 }, { 2, 0, 1073741823, 0 } };
+    Process p[2];
+    SchedResult result;
+
+    load_workload(p, 2, too_long);
+    if (run_case(&config, p, 2, NULL, 0, &result) != SCHED_ERR_CONFIG)
+        fail("time limit", "a run past INT_MAX was not rejected");
+    /* The bursts end at INT_MAX - 1, so the switch costs push them over. */
+    load_workload(p, 2, just_fits);
+    if (run_case(&config, p, 2, NULL, 0, &result) != SCHED_OK || result.last_completion != 2147483646)
+        fail("time limit", "a run ending just below INT_MAX failed");
+    config.overhead = &switch_and_dispatch;
+    if (run_case(&config, p, 2, NULL, 0, &result) != SCHED_ERR_CONFIG)
+        fail("time limit", "switch costs past INT_MAX were not rejected");
+}
+
+int main(void) {
+    test_schedules();
+    test_arena_size();
+    test_gantt_truncation();
+    test_time_limit();
+    if (failures > 0) {
+        printf("%d check(s) failed.\n", failures);
+        return 1;
+    }
+    printf("All tests passed.\n");
+    return 0;
+}